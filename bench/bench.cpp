@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "123.hpp"
+#include "222.hpp"
+#include "223.hpp"
+#include "F2L-1.hpp"
+#include "batch.hpp"  // get_string_option
+#include "multistep.hpp"
+#include "option.hpp"
+#include "two_gen.hpp"
+
+// Benchmark of the solvers on a corpus of random states. The corpus only
+// depends on the seed, so that the results of two commits can be compared.
+// The results are printed as JSON. The bench is always built with the
+// search counters (BLOCK_SOLVER_STATS).
+
+using bench_clock = std::chrono::steady_clock;
+
+double seconds_between(const bench_clock::time_point start,
+                       const bench_clock::time_point end) {
+    if (end == bench_clock::time_point::max()) return -1;
+    return std::chrono::duration<double>(end - start).count();
+}
+
+double seconds_since(const bench_clock::time_point start) {
+    return seconds_between(start, bench_clock::now());
+}
+
+template <typename Array>
+unsigned permutation_parity(const Array& perm) {
+    unsigned parity = 0;
+    for (unsigned i = 0; i < perm.size(); ++i) {
+        for (unsigned j = i + 1; j < perm.size(); ++j) {
+            parity += perm[i] > perm[j];
+        }
+    }
+    return parity % 2;
+}
+
+template <typename Array>
+void shuffle(Array& array, std::mt19937& gen) {
+    // Fisher-Yates with the raw generator output, so that the corpus does
+    // not depend on the standard library implementation
+    for (unsigned i = array.size() - 1; i > 0; --i) {
+        std::swap(array[i], array[gen() % (i + 1)]);
+    }
+}
+
+CubieCube random_state(std::mt19937& gen) {
+    CubieCube cc;
+    shuffle(cc.cp, gen);
+    shuffle(cc.ep, gen);
+    if (permutation_parity(cc.cp) != permutation_parity(cc.ep)) {
+        std::swap(cc.ep[0], cc.ep[1]);
+    }
+    unsigned co_sum = 0, eo_sum = 0;
+    for (unsigned i = 0; i + 1 < NC; ++i) {
+        cc.co[i] = gen() % 3;
+        co_sum += cc.co[i];
+    }
+    for (unsigned i = 0; i + 1 < NE; ++i) {
+        cc.eo[i] = gen() % 2;
+        eo_sum += cc.eo[i];
+    }
+    cc.co[NC - 1] = (3 - co_sum % 3) % 3;
+    cc.eo[NE - 1] = eo_sum % 2;
+    return cc;
+}
+
+struct BenchOptions {
+    unsigned max_depth;  // 0 for the default of each step
+    unsigned slackness;
+    unsigned breadth;
+    bool generate;  // also time the table generation
+    SearchOptions search;
+};
+
+struct SolveRecord {
+    SearchStats stats;
+    double seconds = 0;          // whole solve, initialization included
+    double first_solution = -1;  // -1 when no solution was found
+    double all_optimal = -1;
+    unsigned n_solutions = 0;
+    int optimal = -1;
+};
+
+struct StepReport {
+    std::string step;
+    double table_load = -1;
+    double table_generation = -1;  // -1 when not measured
+    std::vector<SolveRecord> solves;
+};
+
+template <unsigned nc, unsigned ne>
+double time_table_load(Block<nc, ne>& block) {
+    // The solvers load their tables at startup: this loads them a second time
+    auto start = bench_clock::now();
+    BlockMoveTable m_table(block);
+    auto p_table = load_block_pruning_table(block, m_table);
+    return seconds_since(start);
+}
+
+template <unsigned nc, unsigned ne>
+double time_table_generation(Block<nc, ne>& block) {
+    // Generates the tables in memory, the table files are left untouched
+    auto start = bench_clock::now();
+    BlockMoveTable<nc, ne> m_table;
+    m_table.compute_corner_move_tables();
+    m_table.compute_edge_move_tables();
+    if constexpr (use_sym_tables) {
+        SymPruningTable<nc, ne> p_table(block, m_table);
+        p_table.generate(block, m_table);
+    } else {
+        auto p_table = generate_pruning_table(block);
+    }
+    return seconds_since(start);
+}
+
+template <typename Solutions>
+int optimal_depth(const Solutions& solutions) {
+    int optimal = -1;
+    for (auto&& node : solutions) {
+        int depth = node->depth;
+        if (optimal < 0 || depth < optimal) optimal = depth;
+    }
+    return optimal;
+}
+
+template <typename Solve>
+SolveRecord record_solve(const Solve& solve) {
+    // solve() returns the solutions, and the searches it runs on this thread
+    // report their stats
+    SearchStats stats;
+    CollectStats collect(stats);
+    SolveRecord record;
+
+    auto start = bench_clock::now();
+    auto solutions = solve();
+    record.seconds = seconds_since(start);
+    record.stats = stats;
+    record.first_solution = seconds_between(start, stats.first_solution);
+    record.all_optimal = seconds_between(start, stats.all_optimal);
+    record.n_solutions = solutions.size();
+    record.optimal = optimal_depth(solutions);
+    return record;
+}
+
+template <typename Initializer, typename Solver>
+void bench_block(StepReport& report, const Initializer& cc_initialize,
+                 const Solver& solve, const std::vector<CubieCube>& corpus,
+                 const BenchOptions& options) {
+    unsigned max_depth = options.max_depth > 0 ? options.max_depth : 20;
+    for (auto&& cc : corpus) {
+        report.solves.push_back(record_solve([&]() {
+            auto root = cc_initialize(cc);
+            return solve(root, max_depth, options.slackness, options.search);
+        }));
+    }
+}
+
+template <typename Stepper>
+void bench_steps(StepReport& report, const Stepper& solve,
+                 const std::vector<CubieCube>& corpus) {
+    // The steppers return all their solutions at once, the first solution
+    // and all the optimal ones come out together
+    for (auto&& cc : corpus) {
+        auto record = record_solve([&]() { return solve(cc); });
+        record.first_solution = record.n_solutions > 0 ? record.seconds : -1;
+        record.all_optimal = record.first_solution;
+        report.solves.push_back(record);
+    }
+}
+
+StepReport bench_step(const std::string& step,
+                      const std::vector<CubieCube>& corpus,
+                      const BenchOptions& options) {
+    StepReport report{step};
+    auto time_load = [&report](auto... blocks) {
+        report.table_load = (time_table_load(*blocks) + ...);
+    };
+    auto time_generation = [&report, &options](auto... blocks) {
+        if (options.generate) {
+            report.table_generation = (time_table_generation(*blocks) + ...);
+        }
+    };
+
+    if (step == "222") {
+        time_load(&block_solver_222::block);
+        time_generation(&block_solver_222::block);
+        bench_block(report, block_solver_222::cc_initialize,
+                    block_solver_222::solve, corpus, options);
+    } else if (step == "123") {
+        time_load(&block_solver_123::block);
+        time_generation(&block_solver_123::block);
+        bench_block(report, block_solver_123::cc_initialize,
+                    block_solver_123::solve, corpus, options);
+    } else if (step == "223") {
+        time_load(&block_solver_223::block);
+        time_generation(&block_solver_223::block);
+        bench_block(report, block_solver_223::cc_initialize,
+                    block_solver_223::solve, corpus, options);
+    } else if (step == "F2L-1") {
+        time_load(&block_solver_F2Lm1::block1, &block_solver_F2Lm1::block2);
+        time_generation(&block_solver_F2Lm1::block1,
+                        &block_solver_F2Lm1::block2);
+        bench_block(report, block_solver_F2Lm1::cc_initialize,
+                    block_solver_F2Lm1::solve, corpus, options);
+    } else if (step == "multistep") {
+        time_load(&block_solver_222::block, &block_solver_223::block,
+                  &block_solver_F2Lm1::block1, &block_solver_F2Lm1::block2);
+        time_generation(&block_solver_222::block, &block_solver_223::block,
+                        &block_solver_F2Lm1::block1,
+                        &block_solver_F2Lm1::block2);
+        unsigned max_depth = options.max_depth > 0 ? options.max_depth : 20;
+        bench_steps(
+            report,
+            [&](const CubieCube& cc) {
+                return multistep(cc, max_depth, options.breadth,
+                                 options.slackness, options.search.n_threads);
+            },
+            corpus);
+    } else if (step == "two_gen_reduction") {
+        // The first call loads the tables (and generates missing ones)
+        auto start = bench_clock::now();
+        two_gen_reduction::load_tables();
+        report.table_load = seconds_since(start);
+        bench_block(report, two_gen_reduction::cc_initialize,
+                    two_gen_reduction::solve, corpus, options);
+    } else if (step == "two_gen") {
+        auto start = bench_clock::now();
+        two_gen::load_tables();
+        two_gen_reduction::load_tables();
+        report.table_load = seconds_since(start);
+        unsigned max_depth = options.max_depth > 0 ? options.max_depth : 25;
+        bench_steps(
+            report,
+            [&](const CubieCube& cc) {
+                auto root = std::make_shared<StepNode>(cc);
+                return reduction({root}, max_depth, options.breadth,
+                                 options.slackness, options.search.n_threads);
+            },
+            corpus);
+    } else {
+        std::cerr << "Unknown step: " << step << std::endl;
+    }
+    return report;
+}
+
+std::string json_number(const double x) {
+    // Negative values stand for measures that are not available
+    if (x < 0) return "null";
+    std::ostringstream out;
+    out << x;
+    return out.str();
+}
+
+template <typename Array>
+std::string json_array(const Array& array) {
+    std::string ret = "[";
+    for (unsigned k = 0; k < array.size(); ++k) {
+        ret += (k > 0 ? "," : "") + std::to_string(array[k]);
+    }
+    return ret + "]";
+}
+
+template <typename Map>
+std::string json_object(const Map& map) {
+    std::string ret = "{";
+    for (auto&& [key, value] : map) {
+        ret += (ret.size() > 1 ? ", \"" : "\"") + std::to_string(key) +
+               "\": " + std::to_string(value);
+    }
+    return ret + "}";
+}
+
+void write_json(std::ostream& out, const unsigned seed,
+                const std::vector<CubieCube>& corpus,
+                const std::vector<StepReport>& reports,
+                const BenchOptions& options) {
+    out << "{\n";
+    out << "  \"seed\": " << seed << ",\n";
+    out << "  \"n_scrambles\": " << corpus.size() << ",\n";
+    out << "  \"threads\": " << options.search.n_threads << ",\n";
+    out << "  \"simd\": \""
+        << (simd_level == SimdLevel::avx512 ? "avx512"
+            : simd_level == SimdLevel::avx2 ? "avx2"
+                                            : "scalar")
+        << "\",\n";
+    out << "  \"prefetch\": " << (options.search.prefetch ? "true" : "false")
+        << ",\n";
+    out << "  \"corpus\": [\n";
+    for (unsigned k = 0; k < corpus.size(); ++k) {
+        auto&& cc = corpus[k];
+        out << "    {\"cp\": " << json_array(cc.cp)
+            << ", \"co\": " << json_array(cc.co)
+            << ", \"ep\": " << json_array(cc.ep)
+            << ", \"eo\": " << json_array(cc.eo) << "}"
+            << (k + 1 < corpus.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"steps\": [\n";
+    for (unsigned s = 0; s < reports.size(); ++s) {
+        auto&& report = reports[s];
+        SearchStats stats;
+        double seconds = 0;
+        for (auto&& solve : report.solves) {
+            stats.merge(solve.stats);
+            seconds += solve.seconds;
+        }
+        unsigned long nodes = stats.nodes;
+        out << "    {\n";
+        out << "      \"step\": \"" << report.step << "\",\n";
+        out << "      \"table_load_s\": " << json_number(report.table_load)
+            << ",\n";
+        out << "      \"table_generation_s\": "
+            << json_number(report.table_generation) << ",\n";
+        out << "      \"nodes\": " << nodes << ",\n";
+        out << "      \"seconds\": " << json_number(seconds) << ",\n";
+        out << "      \"nodes_per_s\": "
+            << json_number(seconds > 0 ? nodes / seconds : -1) << ",\n";
+        out << "      \"estimate_calls\": " << stats.estimate_calls << ",\n";
+        out << "      \"is_solved_checks\": " << stats.is_solved_checks
+            << ",\n";
+        out << "      \"solutions\": " << stats.solutions << ",\n";
+        out << "      \"table_hits\": " << json_array(stats.table_hits)
+            << ",\n";
+        out << "      \"solves\": [\n";
+        for (unsigned k = 0; k < report.solves.size(); ++k) {
+            auto&& solve = report.solves[k];
+            out << "        {\"nodes\": " << solve.stats.nodes
+                << ", \"iterations\": "
+                << json_object(solve.stats.iteration_nodes)
+                << ", \"seconds\": " << json_number(solve.seconds)
+                << ", \"first_solution_s\": "
+                << json_number(solve.first_solution)
+                << ", \"all_optimal_s\": " << json_number(solve.all_optimal)
+                << ", \"optimal\": "
+                << (solve.optimal < 0 ? "null"
+                                      : std::to_string(solve.optimal))
+                << ", \"n_solutions\": " << solve.n_solutions << "}"
+                << (k + 1 < report.solves.size() ? "," : "") << "\n";
+        }
+        out << "      ]\n";
+        out << "    }" << (s + 1 < reports.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}" << std::endl;
+}
+
+std::vector<std::string> split_steps(const char* list) {
+    std::vector<std::string> steps;
+    std::istringstream input(list);
+    std::string step;
+    while (std::getline(input, step, ',')) {
+        if (!step.empty()) steps.push_back(step);
+    }
+    return steps;
+}
+
+int main(int argc, const char* argv[]) {
+    unsigned seed = get_option("--seed", argc, argv, 1);
+    unsigned n_scrambles = get_option("-n", argc, argv, 10);
+    const char* steps_option = get_string_option("--steps", argc, argv);
+    const char* output_path = get_string_option("-o", argc, argv);
+
+    BenchOptions options;
+    options.max_depth = get_option("-M", argc, argv, 0);
+    options.slackness = get_option("-s", argc, argv, 0);
+    options.breadth = get_option("-b", argc, argv, 5000);
+    options.generate = find_option("--generate", argc, argv);
+    options.search.n_threads = get_option("-j", argc, argv, 1);
+    options.search.prefetch = !find_option("--no-prefetch", argc, argv);
+    if (find_option("--scalar", argc, argv)) {
+        simd_level = SimdLevel::scalar;
+    }
+
+    std::vector<std::string> steps =
+        split_steps(steps_option != nullptr
+                        ? steps_option
+                        : "222,123,223,F2L-1,multistep,two_gen_reduction,"
+                          "two_gen");
+
+    std::mt19937 gen(seed);
+    std::vector<CubieCube> corpus;
+    for (unsigned k = 0; k < n_scrambles; ++k) {
+        corpus.push_back(random_state(gen));
+    }
+
+    std::vector<StepReport> reports;
+    for (auto&& step : steps) {
+        std::cerr << "Benchmarking " << step << std::endl;
+        reports.push_back(bench_step(step, corpus, options));
+    }
+
+    if (output_path == nullptr) {
+        write_json(std::cout, seed, corpus, reports, options);
+    } else {
+        std::ofstream file(output_path);
+        write_json(file, seed, corpus, reports, options);
+    }
+    return 0;
+}
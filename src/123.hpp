@@ -24,4 +24,5 @@ std::array<unsigned, 24> rotations = {  // 24 different 1x2x3 symmetries
 
 auto solve = make_optimal_block_solver(block, rotations);
 auto initialize = make_root_initializer(block, rotations);
+auto cc_initialize = make_root_cc_initializer(block, rotations);
 }  // namespace block_solver_123
\ No newline at end of file
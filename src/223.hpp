@@ -1,4 +1,5 @@
 #pragma once
+#include "lazy_table.hpp"
 #include "move_table.hpp"
 #include "pruning_table.hpp"
 #include "search.hpp"
@@ -12,7 +13,7 @@ namespace block_solver_223 {
 
 constexpr unsigned NB = 2;   // the 2x2x3 is splitted into 2 1x2x3 blocks
 constexpr unsigned NS = 12;  // number of 2x2x3 symmetries
-using Cube = std::array<MultiBlockCube<NB>, NS>;
+using Cube = std::array<SymBlockCube<NS>, NB>;  // one SymBlockCube per 1x2x3
 
 auto block = Block<2, 3>("DB_123", {DLB, DRB}, {DB, RB, LB});
 
@@ -31,60 +32,57 @@ std::array<std::array<unsigned, NB>, NS> rotations = {{
     {symmetry_index(1, 2, 0, 0), symmetry_index(1, 1, 1, 0)},  // RF
 }};
 
-auto m_table = BlockMoveTable(block);
-auto p_table = load_pruning_table(block);
-
-void local_apply(const Move& move, const std::array<unsigned, NB>& syms,
-                 MultiBlockCube<NB>& subcube) {
-    m_table.sym_apply(move, syms[0], subcube[0]);
-    m_table.sym_apply(move, syms[1], subcube[1]);
-};
-
-void apply(const Move& move, Cube& cube) {
+std::array<unsigned, NS> block_rotations(const unsigned b) {
+    // Symmetries under which the b-th 1x2x3 is seen
+    std::array<unsigned, NS> ret;
     for (unsigned k = 0; k < NS; ++k) {
-        local_apply(move, rotations[k], cube[k]);
+        ret[k] = rotations[k][b];
     }
-};
-
-unsigned get_estimate(const CoordinateBlockCube& subcube) {
-    return p_table.estimate(block.index(subcube));
-};
-
-unsigned max_estimate(const MultiBlockCube<NB>& cube) {
-    return get_estimate(cube[0]) > get_estimate(cube[1])
-               ? get_estimate(cube[0])
-               : get_estimate(cube[1]);
+    return ret;
 }
 
-auto estimate = [](const Cube& cube) {
-    unsigned ret = max_estimate(cube[0]);
-    for (unsigned k = 0; k < NS; ++k) {
-        unsigned e = max_estimate(cube[k]);
-        ret = ret < e ? ret : e;
-    }
-    return ret;
+// Loaded by the first search, also used by two_gen_reduction
+LazyTable m_table([] { return BlockMoveTable(block); });
+LazyTable p_table(
+    [] { return load_block_pruning_table(block, m_table.get()); });
+LazyTable sym_tables([] {
+    return std::array<SymMoveTable<BlockMoveTable<2, 3>, NS>, NB>{
+        SymMoveTable(m_table.get(), block_rotations(0)),
+        SymMoveTable(m_table.get(), block_rotations(1))};
+});
+
+using PruningTable = decltype(p_table)::Table;
+
+// Bound to the loaded tables, so that moving a node does not check whether
+// they are loaded
+LazyTable apply([] {
+    return [&tables = sym_tables.get()](const Move& move, Cube& cube) {
+        tables[0].apply(move, cube[0]);
+        tables[1].apply(move, cube[1]);
+    };
+});
+
+unsigned get_estimate(const PruningTable& table,
+                      const PackedBlockCube& subcube) {
+    return table.estimate(block.index(subcube));
 };
 
-bool local_is_solved(const MultiBlockCube<NB>& subcube) {
-    return (block.is_solved(subcube[0]) && block.is_solved(subcube[1]));
-}
+LazyTable estimate([] {
+    return get_split_estimator<NS>(p_table.get(), block, p_table.get(), block);
+});
 
 auto is_solved = [](const Cube& cube) {
     for (unsigned k = 0; k < NS; ++k) {
-        if (local_is_solved(cube[k])) return true;
+        if (block.is_solved(cube[0][k]) && block.is_solved(cube[1][k])) {
+            return true;
+        }
     }
     return false;
 };
 
 auto cc_initialize(const CubieCube& scramble_cc) {
-    Cube ret;
-
-    for (unsigned k = 0; k < NS; ++k) {
-        ret[k][0] = block.to_coordinate_block_cube(
-            scramble_cc.get_conjugate(rotations[k][0]));
-        ret[k][1] = block.to_coordinate_block_cube(
-            scramble_cc.get_conjugate(rotations[k][1]));
-    }
+    Cube ret{make_sym_block_cube(block, scramble_cc, block_rotations(0)),
+             make_sym_block_cube(block, scramble_cc, block_rotations(1))};
 
     return make_root(ret);
 }
@@ -96,10 +94,13 @@ auto initialize(const Algorithm& scramble) {
 
 using NodePtr = Node<Cube>::sptr;
 
-auto solve(const NodePtr root, const unsigned move_budget = 20,
-           const unsigned slackness = 0) {
-    return IDAstar<false>(root, apply, estimate, is_solved, move_budget,
-                          slackness);
-}
+// A lambda rather than a function, so that the default arguments survive
+// when the solver is handed to a stepper
+auto solve = [](const NodePtr root, const unsigned move_budget = 20,
+                const unsigned slackness = 0,
+                const SearchOptions& options = {}) {
+    return ida_search(root, apply.get(), estimate.get(), is_solved,
+                      move_budget, slackness, options);
+};
 
 }  // namespace block_solver_223
\ No newline at end of file
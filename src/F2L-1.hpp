@@ -34,5 +34,11 @@ auto initialize(const Algorithm &scramble) {
     return cc_initialize(cc);
 }
 
-auto solve = make_optimal_split_block_solver(block1, block2, rotations);
+auto solve = [] {
+    if constexpr (use_mod3_tables) {
+        return make_mod3_split_block_solver(block1, block2, rotations);
+    } else {
+        return make_optimal_split_block_solver(block1, block2, rotations);
+    }
+}();
 }  // namespace block_solver_F2Lm1
\ No newline at end of file
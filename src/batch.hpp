@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>              // next scramble to solve
+#include <condition_variable>  // wait for the next report in order
+#include <cstring>             // strcmp
+#include <fstream>             // read scrambles from a file
+#include <functional>          // std::function
+#include <iostream>            // std::cin
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BatchEntry {
+    std::string id;        // identifier printed in front of the results
+    std::string scramble;  // scramble as written in the input
+};
+
+const char* get_string_option(const char* name, int argc, const char* argv[]) {
+    // Returns the argument following the option name, nullptr if the option
+    // is not present
+    for (int k = 1; k + 1 < argc; ++k) {
+        if (strcmp(argv[k], name) == 0) return argv[k + 1];
+    }
+    return nullptr;
+}
+
+std::vector<BatchEntry> read_batch(std::istream& input) {
+    // Reads one scramble per line. A line is either a bare scramble, in which
+    // case its id is the line number, or an id and a scramble separated by a
+    // tab. Empty lines and lines starting with '#' are skipped.
+    std::vector<BatchEntry> entries;
+    std::string line;
+    unsigned line_number = 0;
+
+    while (std::getline(input, line)) {
+        ++line_number;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.find_first_not_of(" \t") == std::string::npos) continue;
+        if (line[0] == '#') continue;
+
+        auto tab = line.find('\t');
+        if (tab == std::string::npos) {
+            entries.push_back({std::to_string(line_number), line});
+        } else {
+            entries.push_back({line.substr(0, tab), line.substr(tab + 1)});
+        }
+    }
+    return entries;
+}
+
+std::vector<BatchEntry> read_batch(const char* path) {
+    // "-" reads the scrambles from the standard input
+    if (strcmp(path, "-") == 0) {
+        return read_batch(std::cin);
+    }
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open scramble file: " << path << std::endl;
+        return {};
+    }
+    return read_batch(file);
+}
+
+// Writes the results of one solve into the given stream. Solving and
+// printing are separated so that worker threads can solve while the main
+// thread prints in input order.
+using Report = std::function<void(std::ostream&)>;
+// Receives the output of a solve piece by piece, as soon as it is known
+using ReportSink = std::function<void(const Report&)>;
+
+template <typename Solver>
+void run_batch(const std::vector<BatchEntry>& entries, const Solver& solve,
+               unsigned n_threads = 1) {
+    // Solves every entry with solve(entry), which must return a Report.
+    // Scrambles are handed out to n_threads workers one at a time, and the
+    // tables are shared between them: the solvers only read them once they
+    // are loaded. Reports are printed in the input order.
+    if (n_threads < 1) n_threads = 1;
+
+    std::vector<Report> reports(entries.size());
+    std::vector<bool> done(entries.size(), false);
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable report_ready;
+
+    auto worker = [&]() {
+        for (size_t k = next++; k < entries.size(); k = next++) {
+            Report report = solve(entries[k]);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                reports[k] = std::move(report);
+                done[k] = true;
+            }
+            report_ready.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < n_threads; ++t) {
+        workers.emplace_back(worker);
+    }
+
+    for (size_t k = 0; k < entries.size(); ++k) {
+        Report report;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            report_ready.wait(lock, [&]() { return done[k]; });
+            report = std::move(reports[k]);  // frees the solutions once shown
+        }
+        std::cout << "# " << entries[k].id << ": " << entries[k].scramble
+                  << std::endl;
+        report(std::cout);
+    }
+
+    for (auto&& w : workers) {
+        w.join();
+    }
+}
@@ -19,7 +19,8 @@ struct Block {
     std::string name;
     std::string id;
 
-    CoordinateBlockCube solved;  // The solved state cbc
+    CoordinateBlockCube solved;     // The solved state cbc
+    PackedBlockCube solved_packed;  // and its packed version
 
     static constexpr unsigned n_cp = factorial(nc);
     static constexpr unsigned n_co = ipow(3, nc);
@@ -30,15 +31,6 @@ struct Block {
     static constexpr size_t n_cs = n_cp * n_co * n_cl;
     static constexpr size_t n_es = n_ep * n_eo * n_el;
 
-   private:
-    // Buffer arrays for CubieCube <=> CoordinateBlockCube conversion
-    std::array<unsigned, NC> cl;  // Corner layout
-    std::array<unsigned, NE> el;  // Edge layout
-    std::array<unsigned, nc> cp;  // Permutation of the block corners
-    std::array<unsigned, ne> ep;  // Permutation of the block edges
-    std::array<unsigned, nc> co;  // Orientation of the block corners
-    std::array<unsigned, ne> eo;  // Orientation of the block edges
-   public:
     Block() {}
 
     Block(std::string n, const std::array<Corner, nc> &c,
@@ -54,6 +46,7 @@ struct Block {
                   [](const Cubie &e1, const Cubie &e2) { return (e1 < e2); });
         id = compute_id();
         solved = to_coordinate_block_cube(CubieCube());
+        solved_packed = pack(solved);
     };
 
     std::string compute_id() const {
@@ -85,9 +78,18 @@ struct Block {
         return (std::find(edges.begin(), edges.end(), e) != std::end(edges));
     }
 
-    CoordinateBlockCube to_coordinate_block_cube(const CubieCube &cc) {
+    CoordinateBlockCube to_coordinate_block_cube(const CubieCube &cc) const {
         // Returns the coordinate representation
-        // of the block state in the input CubieCube
+        // of the block state in the input CubieCube.
+        // The conversion buffers live on the stack so that a Block
+        // can be shared between threads.
+
+        std::array<unsigned, NC> cl;  // Corner layout
+        std::array<unsigned, NE> el;  // Edge layout
+        std::array<unsigned, nc> cp;  // Permutation of the block corners
+        std::array<unsigned, ne> ep;  // Permutation of the block edges
+        std::array<unsigned, nc> co;  // Orientation of the block corners
+        std::array<unsigned, ne> eo;  // Orientation of the block edges
 
         CoordinateBlockCube cbc;
         unsigned k = 0;
@@ -132,7 +134,7 @@ struct Block {
         return cbc;
     }
 
-    CubieCube to_cubie_cube(const CoordinateBlockCube &cbc) {
+    CubieCube to_cubie_cube(const CoordinateBlockCube &cbc) const {
         // Takes in a CoordinateBlockCube and returns the corresponding
         // CubieCube. All pieces that do not belong to the block are set to
         // default inconsistent values:
@@ -140,6 +142,13 @@ struct Block {
         // This means that the resulting CubieCube cannot be used as a
         // right multiplicator
 
+        std::array<unsigned, NC> cl;
+        std::array<unsigned, NE> el;
+        std::array<unsigned, nc> cp;
+        std::array<unsigned, ne> ep;
+        std::array<unsigned, nc> co;
+        std::array<unsigned, ne> eo;
+
         CubieCube cc;
         unsigned k;
         if constexpr (nc > 0) {
@@ -187,6 +196,26 @@ struct Block {
         return ei * n_cs + ci;
     }
 
+    unsigned index(const PackedBlockCube &pbc) const {
+        // Same index as for the unpacked cube: ccl * n_cp + ccp is already
+        // stored in cclp, and the same goes for the edges
+        return (pbc.celp * n_eo + pbc.ceo) * n_cs + (pbc.cclp * n_co + pbc.cco);
+    }
+
+    PackedBlockCube pack(const CoordinateBlockCube &cbc) const {
+        return PackedBlockCube(cbc.ccl, cbc.cel, cbc.ccl * n_cp + cbc.ccp,
+                               cbc.cel * n_ep + cbc.cep, cbc.cco, cbc.ceo);
+    }
+
+    CoordinateBlockCube unpack(const PackedBlockCube &pbc) const {
+        return CoordinateBlockCube(pbc.ccl, pbc.cel, pbc.cclp % n_cp,
+                                   pbc.celp % n_ep, pbc.cco, pbc.ceo);
+    }
+
+    PackedBlockCube to_packed_block_cube(const CubieCube &cc) const {
+        return pack(to_coordinate_block_cube(cc));
+    }
+
     CoordinateBlockCube to_coordinate_block_cube(const unsigned &coord) const {
         unsigned ci = coord % n_cs;
         unsigned ccl = ci / (n_cp * n_co);
@@ -200,7 +229,8 @@ struct Block {
     }
 
     auto get_indexer() const {
-        return [this](const CoordinateBlockCube &cbc) { return index(cbc); };
+        // Works with both CoordinateBlockCube and PackedBlockCube
+        return [this](const auto &cube) { return index(cube); };
     }
 
     auto get_from_index() const {
@@ -209,13 +239,19 @@ struct Block {
         };
     }
 
-    bool is_solved(const CoordinateBlockCube &cbc) { return cbc == solved; }
+    bool is_solved(const CoordinateBlockCube &cbc) const {
+        return cbc == solved;
+    }
+
+    bool is_solved(const PackedBlockCube &pbc) const {
+        return pbc == solved_packed;
+    }
 
-    auto get_is_solved() {
-        return [this](const CoordinateBlockCube &cbc) { return cbc == solved; };
+    auto get_is_solved() const {
+        return [this](const auto &cube) { return is_solved(cube); };
     }
 
-    CoordinateBlockCube get_scrambled_cbc(const Algorithm &scramble) {
+    CoordinateBlockCube get_scrambled_cbc(const Algorithm &scramble) const {
         return to_coordinate_block_cube(CubieCube(scramble));
     }
 
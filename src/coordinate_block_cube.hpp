@@ -22,7 +22,7 @@ struct CoordinateBlockCube {
         ceo = ceo_in;
     };
 
-    bool operator==(const CoordinateBlockCube& other) {
+    bool operator==(const CoordinateBlockCube& other) const {
         return (ccl == other.ccl && cel == other.cel && ccp == other.ccp &&
                 cep == other.cep && cco == other.cco && ceo == other.ceo);
     }
@@ -38,8 +38,37 @@ struct CoordinateBlockCube {
     };
 };
 
-template <unsigned nb>
-struct MultiBlockCube : std::array<CoordinateBlockCube, nb> {
+struct PackedBlockCube {
+    // The same coordinates with layout and permutation packed together as
+    // cl * n_p + p. Moves are then plain table lookups and the pruning index
+    // is a few multiply-adds, with no division on the search path. The layout
+    // coordinates are kept next to the packed ones for the orientation tables.
+    unsigned ccl, cel, cclp, celp, cco, ceo;
+
+    PackedBlockCube() : ccl{0}, cel{0}, cclp{0}, celp{0}, cco{0}, ceo{0} {};
+
+    PackedBlockCube(unsigned ccl, unsigned cel, unsigned cclp, unsigned celp,
+                    unsigned cco, unsigned ceo)
+        : ccl{ccl}, cel{cel}, cclp{cclp}, celp{celp}, cco{cco}, ceo{ceo} {};
+
+    bool operator==(const PackedBlockCube& other) const {
+        return (cclp == other.cclp && celp == other.celp && cco == other.cco &&
+                ceo == other.ceo);
+    }
+
+    void show() const {
+        std::cout << "PackedBlockCube:\n";
+        std::cout << " Corner layout coordinate: " << ccl << '\n';
+        std::cout << " Packed CP coordinate: " << cclp << '\n';
+        std::cout << " CO coordinate: " << cco << '\n';
+        std::cout << " Edge layout coordinate: " << cel << '\n';
+        std::cout << " Packed EP coordinate: " << celp << '\n';
+        std::cout << " EO coordinate: " << ceo << '\n';
+    };
+};
+
+template <unsigned nb, typename BlockCube = CoordinateBlockCube>
+struct MultiBlockCube : std::array<BlockCube, nb> {
     void show() const {
         std::cout << "MultiBlockCube<" << nb << ">" << std::endl;
         for (unsigned k = 0; k < nb; ++k) {
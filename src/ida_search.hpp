@@ -0,0 +1,438 @@
+#pragma once
+#include <algorithm>   // std::max
+#include <array>       // successor lists
+#include <atomic>      // solutions counter
+#include <deque>       // per worker task queues
+#include <functional>  // std::function
+#include <mutex>       // task queue locks
+#include <thread>      // workers
+#include <vector>
+
+#include "cubie_cube.hpp"     // move commutations
+#include "search.hpp"         // Node, make_root, IDAstar
+#include "search_budget.hpp"  // SearchBudget
+#include "search_stats.hpp"   // SearchStats
+
+// Receives the moves of a solution, from the root of the search
+using SolutionSink = std::function<void(const std::vector<Move>& path)>;
+
+struct MoveSuccessors;
+
+struct SearchOptions {
+    unsigned n_threads = 1;    // number of worker threads
+    unsigned split_depth = 0;  // depth of the shared frontier, 0 for automatic
+    bool prefetch = true;      // prefetch the pruning entries of the children
+    unsigned first_bound = 0;  // known to have no shorter solution
+    unsigned* root_estimate = nullptr;  // receives the estimate of the root
+    // Moves of the search, all the HTM moves when nullptr
+    const MoveSuccessors* successors = nullptr;
+    // When set, ida_search hands the solutions to the sink as it finds them,
+    // shortest first and one at a time, instead of returning them
+    SolutionSink sink;
+};
+
+struct MoveSuccessors {
+    // For every last move (and for the root, at index N_HTM_MOVES), the list
+    // of moves that may follow it. Moves on the same face are merged and
+    // commuting moves on opposite faces are only allowed in increasing order,
+    // which is the canonical sequence order used by the serial search. A
+    // search may be restricted to some of the moves, e.g. <R, U>.
+    std::array<std::vector<Move>, N_HTM_MOVES + 1> next;
+
+    MoveSuccessors(const std::vector<Move>& moves = {HTM_Moves.begin(),
+                                                     HTM_Moves.end()}) {
+        std::array<CubieCube, N_HTM_MOVES> cubes;
+        for (Move m : HTM_Moves) {
+            cubes[m].apply(m);
+        }
+
+        for (Move last : moves) {
+            for (Move m : moves) {
+                CubieCube last_then_m = cubes[last], m_then_last = cubes[m];
+                last_then_m.apply(m);
+                m_then_last.apply(last);
+
+                bool same_face = last_then_m.is_solved();
+                for (Move single : HTM_Moves) {
+                    same_face = same_face || (last_then_m == cubes[single]);
+                }
+                bool commute = (last_then_m == m_then_last);
+
+                if (!same_face && !(commute && m < last)) {
+                    next[last].push_back(m);
+                }
+            }
+        }
+        next[N_HTM_MOVES] = moves;
+    }
+
+    const std::vector<Move>& operator[](const unsigned last) const {
+        return next[last];
+    }
+};
+
+const MoveSuccessors htm_successors;
+
+template <typename Pruner, typename Cube>
+bool within_budget(const Pruner& estimate, const Cube& cube,
+                   const unsigned budget) {
+    // True if the estimate of cube is at most budget. Estimators that have a
+    // within(cube, budget) method can stop as soon as one of the symmetries
+    // is within the budget, instead of computing the exact minimum.
+    if constexpr (requires { estimate.within(cube, budget); }) {
+        return estimate.within(cube, budget);
+    } else {
+        return estimate(cube) <= budget;
+    }
+}
+
+template <typename Pruner>
+struct EstimateLookup {
+    // What an estimator computes of a child before reading the tables, kept
+    // next to the child from prefetch_estimate to within_budget. Nothing for
+    // the estimators without a Lookup type.
+    struct type {};
+};
+
+template <typename Pruner>
+    requires requires { typename Pruner::Lookup; }
+struct EstimateLookup<Pruner> {
+    using type = typename Pruner::Lookup;
+};
+
+template <typename Pruner, typename Cube, typename Lookup>
+void prefetch_estimate(const Pruner& estimate, const Cube& cube,
+                       Lookup& lookup, const bool prefetch) {
+    // Starts loading the table entries that estimate(cube) will read, for
+    // the estimators that have a prefetch method. Those that have a Lookup
+    // compute it here, once, prefetch or not.
+    if constexpr (requires { estimate.look_up(cube, lookup); }) {
+        estimate.look_up(cube, lookup);
+        if (prefetch) estimate.prefetch(lookup);
+    } else if constexpr (requires { estimate.prefetch(cube); }) {
+        if (prefetch) estimate.prefetch(cube);
+    }
+}
+
+template <typename Pruner, typename Cube, typename Lookup>
+bool within_budget(const Pruner& estimate, const Cube& cube,
+                   const Lookup& lookup, const unsigned budget) {
+    // within_budget from the lookup made by prefetch_estimate
+    if constexpr (requires { estimate.within(lookup, budget); }) {
+        return estimate.within(lookup, budget);
+    } else {
+        return within_budget(estimate, cube, budget);
+    }
+}
+
+template <typename Cube>
+struct SearchTask {
+    // Root of a subtree of the IDA* iteration, shared between the workers
+    Cube state;
+    unsigned depth;
+    unsigned last;  // last move, N_HTM_MOVES for the root
+    std::vector<Move> path;
+};
+
+template <typename Cube, typename Mover, typename Pruner, typename SolveCheck>
+struct BoundedSearch {
+    // Depth first search that collects the solutions of length exactly
+    // `bound`. Solved nodes are not expanded, as in the serial search.
+    // All the children of a node are generated before the first one is
+    // estimated, so that with `prefetch` their pruning table entries are
+    // loaded from memory at the same time instead of one after the other.
+    // It stops early, with the solutions found so far, when its budget runs
+    // out.
+    const Mover& apply;
+    const Pruner& estimate;
+    const SolveCheck& is_solved;
+    unsigned bound;
+    bool prefetch = true;
+    BudgetMeter meter;
+    const SolutionSink* sink = nullptr;  // where solutions go, if not kept
+    const MoveSuccessors* successors = &htm_successors;
+
+    struct Child {
+        Cube state;
+        [[no_unique_address]] typename EstimateLookup<Pruner>::type lookup;
+    };
+
+    std::vector<Move> path;
+    std::vector<std::vector<Move>> solutions;
+    std::deque<std::array<Child, N_HTM_MOVES>> children;  // one per depth
+    SearchStats stats;
+
+    void search(const Cube& cube, const unsigned depth, const unsigned last) {
+        if (meter.is_stopped()) return;
+        stats.count_is_solved();
+        if (is_solved(cube)) {
+            if (depth == bound) add_solution();
+            return;
+        }
+        if (depth == bound) return;
+
+        // A deque keeps the children of the lower depths in place
+        while (children.size() <= depth) children.emplace_back();
+        auto& next = children[depth];
+        auto& moves = (*successors)[last];
+        for (unsigned k = 0; k < moves.size(); ++k) {
+            next[k].state = cube;
+            apply(moves[k], next[k].state);
+            prefetch_estimate(estimate, next[k].state, next[k].lookup,
+                              prefetch);
+        }
+        stats.count_nodes(moves.size());
+        meter.spend(moves.size());
+
+        for (unsigned k = 0; k < moves.size(); ++k) {
+            stats.count_estimate();
+            if (!within_budget(estimate, next[k].state, next[k].lookup,
+                               bound - depth - 1)) {
+                continue;
+            }
+
+            path.push_back(moves[k]);
+            search(next[k].state, depth + 1, moves[k]);
+            path.pop_back();
+        }
+    }
+
+    void search(const SearchTask<Cube>& task) {
+        path = task.path;
+        search(task.state, task.depth, task.last);
+    }
+
+    void add_solution() {
+        stats.count_solution();
+        if (sink != nullptr) {
+            (*sink)(path);
+        } else {
+            solutions.push_back(path);
+        }
+    }
+};
+
+template <typename Cube, typename Mover, typename Pruner, typename SolveCheck>
+auto split_frontier(const Cube& root, const Mover& apply,
+                    const Pruner& estimate, const SolveCheck& is_solved,
+                    const unsigned bound, const unsigned split_depth,
+                    const size_t min_tasks, const MoveSuccessors& successors,
+                    SearchStats& stats) {
+    // Expands the tree level by level until it holds at least min_tasks
+    // subtrees (or until split_depth when it is set). Solved nodes and
+    // nodes at the bound are kept as leaf tasks. The tasks come out in the
+    // order of a depth first search, so that merging their solutions in task
+    // order gives back the serial solution order.
+    std::vector<SearchTask<Cube>> frontier{{root, 0, N_HTM_MOVES, {}}};
+
+    for (unsigned depth = 0; depth < bound; ++depth) {
+        if (split_depth > 0 ? depth >= split_depth
+                            : frontier.size() >= min_tasks) {
+            break;
+        }
+        std::vector<SearchTask<Cube>> next;
+        for (auto&& task : frontier) {
+            // A solved task is counted by the worker that searches it, as
+            // in the serial search
+            if (task.depth < depth || is_solved(task.state)) {
+                next.push_back(task);
+                continue;
+            }
+            stats.count_is_solved();
+            for (Move move : successors[task.last]) {
+                Cube child = task.state;
+                apply(move, child);
+                stats.count_nodes(1);
+                stats.count_estimate();
+                if (!within_budget(estimate, child, bound - depth - 1)) {
+                    continue;
+                }
+
+                auto child_path = task.path;
+                child_path.push_back(move);
+                next.push_back({child, depth + 1, move, child_path});
+            }
+        }
+        frontier = std::move(next);
+    }
+    return frontier;
+}
+
+class TaskQueues {
+    // One queue of task indices per worker. A worker pops its own tasks from
+    // the front and steals from the back of the other queues once its own
+    // queue is empty.
+    std::vector<std::deque<size_t>> queues;
+    std::vector<std::mutex> locks;
+
+   public:
+    TaskQueues(const size_t n_tasks, const unsigned n_workers)
+        : queues(n_workers), locks(n_workers) {
+        // Contiguous blocks keep neighbouring subtrees on the same worker
+        for (size_t k = 0; k < n_tasks; ++k) {
+            queues[k * n_workers / n_tasks].push_back(k);
+        }
+    }
+
+    bool pop(const unsigned worker, size_t& task) {
+        {
+            std::lock_guard<std::mutex> lock(locks[worker]);
+            if (!queues[worker].empty()) {
+                task = queues[worker].front();
+                queues[worker].pop_front();
+                return true;
+            }
+        }
+        for (unsigned offset = 1; offset < queues.size(); ++offset) {
+            unsigned victim = (worker + offset) % queues.size();
+            std::lock_guard<std::mutex> lock(locks[victim]);
+            if (!queues[victim].empty()) {
+                task = queues[victim].back();
+                queues[victim].pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+template <typename Cube, typename Mover, typename Pruner, typename SolveCheck>
+void parallel_bounded_search(const Cube& root, const Mover& apply,
+                             const Pruner& estimate,
+                             const SolveCheck& is_solved, const unsigned bound,
+                             const SearchOptions& options,
+                             const SolutionSink& emit, SearchStats& stats) {
+    // One IDA* iteration: the frontier is split into tasks which the workers
+    // share through work stealing. Hands the solutions of length `bound` to
+    // emit, in the order of the serial search.
+    const unsigned n_threads = options.n_threads > 0 ? options.n_threads : 1;
+    SearchBudget* budget = search_budget;  // spent by all the workers
+    const MoveSuccessors* successors =
+        options.successors != nullptr ? options.successors : &htm_successors;
+    if (n_threads == 1) {
+        BoundedSearch<Cube, Mover, Pruner, SolveCheck> dfs{
+            apply, estimate, is_solved, bound, options.prefetch, budget, &emit,
+            successors};
+        CollectStats collect(dfs.stats);  // table hits of the estimator
+        dfs.search(root, 0, N_HTM_MOVES);
+        stats.merge(dfs.stats);
+        return;
+    }
+
+    auto tasks =
+        split_frontier(root, apply, estimate, is_solved, bound,
+                       options.split_depth, 16 * n_threads, *successors, stats);
+
+    // The solutions of a task are emitted once the tasks before it are done
+    std::vector<std::vector<std::vector<Move>>> task_solutions(tasks.size());
+    std::vector<bool> task_done(tasks.size(), false);
+    size_t next_task = 0;
+    std::mutex emit_mutex;
+    auto finish = [&](const size_t k, std::vector<std::vector<Move>>& s) {
+        std::lock_guard<std::mutex> lock(emit_mutex);
+        task_solutions[k] = std::move(s);
+        task_done[k] = true;
+        for (; next_task < tasks.size() && task_done[next_task]; ++next_task) {
+            for (auto&& path : task_solutions[next_task]) {
+                emit(path);
+            }
+            task_solutions[next_task] = {};
+        }
+    };
+
+    std::vector<SearchStats> worker_stats(n_threads);
+    TaskQueues queues(tasks.size(), n_threads);
+
+    auto worker = [&](const unsigned id) {
+        BoundedSearch<Cube, Mover, Pruner, SolveCheck> dfs{
+            apply, estimate, is_solved, bound, options.prefetch, budget,
+            nullptr, successors};
+        CollectStats collect(dfs.stats);
+        size_t k;
+        while (queues.pop(id, k)) {
+            dfs.solutions.clear();
+            dfs.search(tasks[k]);
+            finish(k, dfs.solutions);
+        }
+        worker_stats[id] = dfs.stats;
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned id = 0; id < n_threads; ++id) {
+        workers.emplace_back(worker, id);
+    }
+    for (auto&& w : workers) {
+        w.join();
+    }
+    for (auto&& partial : worker_stats) {
+        stats.merge(partial);
+    }
+}
+
+template <typename NodePtr, typename Mover>
+NodePtr make_solution_node(const NodePtr root, const std::vector<Move>& path,
+                           const Mover& apply) {
+    // Rebuilds the chain of nodes from the root along the solution path
+    NodePtr node = root;
+    for (Move move : path) {
+        auto state = node->state;
+        apply(move, state);
+        NodePtr child = make_root(state);
+        child->depth = node->depth + 1;
+        child->parent = node;
+        child->last_move = move;
+        node = child;
+    }
+    return node;
+}
+
+template <typename NodePtr, typename Mover, typename Pruner,
+          typename SolveCheck>
+auto ida_search(const NodePtr root, const Mover& apply, const Pruner& estimate,
+                const SolveCheck& is_solved, const unsigned max_depth,
+                const unsigned slackness, const SearchOptions& options = {}) {
+    // IDA* whose iterations are split between options.n_threads workers.
+    // It finds the same solutions as IDAstar: every solution of length
+    // optimal to optimal + slackness (and at most max_depth). Unlike IDAstar,
+    // it hands the remaining budget to the estimator, see within_budget.
+    // When the SearchBudget of the thread runs out, it returns the solutions
+    // found so far. With options.sink, the solutions are streamed instead.
+    decltype(IDAstar<false>(root, apply, estimate, is_solved, max_depth,
+                            slackness)) solutions;
+    unsigned optimal = max_depth + 1;
+    // The table hits of the root and of the frontier go straight to the
+    // caller's stats, the other counters are merged at the end
+    SearchStats stats;
+
+    unsigned long found = 0;  // solutions of the current bound
+    SolutionSink emit = [&](const std::vector<Move>& path) {
+        ++found;
+        if (options.sink) {
+            options.sink(path);
+        } else {
+            solutions.push_back(make_solution_node(root, path, apply));
+        }
+    };
+
+    stats.count_estimate();
+    unsigned root_estimate = estimate(root->state);
+    if (options.root_estimate != nullptr) {
+        *options.root_estimate = root_estimate;
+    }
+    for (unsigned bound = std::max(root_estimate, options.first_bound);
+         bound <= max_depth && bound <= optimal + slackness &&
+         !search_stopped();
+         ++bound) {
+        unsigned long start_nodes = stats.nodes;
+        found = 0;
+        parallel_bounded_search(root->state, apply, estimate, is_solved, bound,
+                                options, emit, stats);
+        bool first = found > 0 && optimal > max_depth;
+        if (first) optimal = bound;
+        stats.end_iteration(bound, start_nodes, first);
+    }
+    if (collected_stats != nullptr) {
+        collected_stats->merge(stats);
+    }
+    return solutions;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>       // loaded flag read by the searches
+#include <mutex>        // std::call_once
+#include <optional>     // the table, once loaded
+#include <type_traits>  // std::invoke_result_t
+
+template <typename Loader>
+struct LazyTable {
+    // Holds the table returned by loader(), which is only called the first
+    // time the table is used. The steps keep their tables in LazyTables so
+    // that a process loads the tables of the steps it runs and nothing else.
+    // The table is loaded once even when several threads need it at the same
+    // time; afterwards get() costs a single load of the flag.
+    using Table = std::invoke_result_t<Loader>;
+
+    Loader loader;
+    std::once_flag once;
+    std::atomic<bool> loaded = false;
+    std::optional<Table> table;
+
+    LazyTable(Loader loader) : loader{loader} {}
+
+    Table& get() {
+        if (!loaded.load(std::memory_order_acquire)) {
+            std::call_once(once, [this] {
+                table.emplace(loader());
+                loaded.store(true, std::memory_order_release);
+            });
+        }
+        return *table;
+    }
+
+    bool is_loaded() const { return loaded.load(std::memory_order_acquire); }
+};
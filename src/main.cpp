@@ -1,122 +1,294 @@
 #include <cassert>
+#include <chrono>   // --time
+#include <cstdlib>  // strtoul
 #include <cstring>
+#include <stdexcept>  // invalid serve requests
+#include <string>
+#include <thread>  // default number of serve workers
 
 #include "123.hpp"
 #include "222.hpp"
 #include "223.hpp"
 #include "F2L-1.hpp"
+#include "batch.hpp"
 #include "multistep.hpp"
 #include "option.hpp"
+#include "serve.hpp"
+#include "solution_output.hpp"
 #include "two_gen.hpp"
 
-int main(int argc, const char* argv[]) {
-    auto scramble = Algorithm(argv[argc - 1]);
+bool is_step(const char* step) {
+    for (auto name : {"123", "222", "223", "F2L-1", "multistep",
+                      "two_gen_finish", "two_gen_reduction", "two_gen"}) {
+        if (strcmp(step, name) == 0) return true;
+    }
+    return false;
+}
+
+void check_scramble(const std::string& step, const Algorithm& scramble) {
+    // Throws std::invalid_argument for the scrambles the step cannot solve,
+    // before they reach its solver
+    if (step == "two_gen_finish" &&
+        !two_gen::two_gen_symmetry(CubieCube(scramble))) {
+        throw std::invalid_argument("scramble is not two gen");
+    }
+}
+
+Report solution_report(const std::vector<Move>& path, const bool inverse) {
+    // One solution, written the way Solutions::show prints it
+    return [path, inverse](std::ostream& out) {
+        write_solution(out, path, inverse);
+    };
+}
+
+template <typename Initializer, typename Solver>
+Report solve_block(const Initializer& initialize, const Solver& solve,
+                   const Algorithm& scramble, const unsigned max_depth,
+                   const unsigned slackness, const bool linear,
+                   const SearchOptions& options, const ReportSink& emit) {
+    if (emit) {
+        // Every solution is shown as soon as IDA* finds it, shortest first,
+        // and none of them are kept
+        auto stream = [&](const Algorithm& alg, const bool inverse) {
+            auto root = initialize(alg);
+            SearchOptions streaming = options;
+            streaming.sink = [&](const std::vector<Move>& path) {
+                emit(solution_report(path, inverse));
+            };
+            solve(root, max_depth, slackness, streaming);
+        };
+        stream(scramble, false);
+        if (linear) stream(scramble.get_inverse(), true);
+        return [](std::ostream&) {};
+    }
+
+    auto root = initialize(scramble);
+    auto solutions = solve(root, max_depth, slackness, options);
+    solutions.sort_by_depth();
+
+    decltype(solutions) solutions_inverse;
+    if (linear) {
+        auto root_inverse = initialize(scramble.get_inverse());
+        solutions_inverse =
+            solve(root_inverse, max_depth, slackness, options);
+        solutions_inverse.sort_by_depth();
+    }
 
+    return [solutions, solutions_inverse](std::ostream& out) {
+        write_solutions(out, solutions);
+        write_solutions(out, solutions_inverse, true);
+    };
+}
+
+Report solve_step(const char* step, const Algorithm& scramble, int argc,
+                  const char* argv[], const SearchOptions& options,
+                  const ReportSink& emit) {
+    // The block steps stream their solutions to emit when it is set, the
+    // other ones return them all in the report
     unsigned slackness = get_option("-s", argc, argv, 0);
     unsigned max_depth = get_option("-M", argc, argv, 15);
     unsigned breadth = get_option("-b", argc, argv, 5000);
     bool linear = find_option("-L", argc, argv);
 
-    if (strcmp(argv[1], "123") == 0) {
-        auto root = block_solver_123::initialize(scramble);
-        auto solutions = block_solver_123::solve(root, max_depth, slackness);
-        solutions.sort_by_depth();
-        solutions.show();
-
-        if (linear) {
-            auto root_inverse =
-                block_solver_123::initialize(scramble.get_inverse());
-            auto solutions_inverse =
-                block_solver_123::solve(root_inverse, max_depth, slackness);
-            solutions_inverse.sort_by_depth();
-            solutions_inverse.show(true);
-        }
-    } else if (strcmp(argv[1], "222") == 0) {
-        auto root = block_solver_222::initialize(scramble);
-        auto solutions = block_solver_222::solve(root, max_depth, slackness);
-        solutions.sort_by_depth();
-        solutions.show();
-
-        if (linear) {
-            auto root_inverse =
-                block_solver_222::initialize(scramble.get_inverse());
-            auto solutions_inverse =
-                block_solver_222::solve(root_inverse, max_depth, slackness);
-            solutions_inverse.sort_by_depth();
-            solutions_inverse.show(true);
-        }
-    } else if (strcmp(argv[1], "223") == 0) {
-        auto root = block_solver_223::initialize(scramble);
-        auto solutions = block_solver_223::solve(root, max_depth, slackness);
-        solutions.sort_by_depth();
-        solutions.show();
-
-        if (linear) {
-            auto root_inverse =
-                block_solver_223::initialize(scramble.get_inverse());
-            auto solutions_inverse =
-                block_solver_223::solve(root_inverse, max_depth, slackness);
-            solutions_inverse.sort_by_depth();
-            solutions_inverse.show(true);
-        }
-    } else if (strcmp(argv[1], "F2L-1") == 0) {
-        auto root = block_solver_F2Lm1::initialize(scramble);
-        auto solutions = block_solver_F2Lm1::solve(root, max_depth, slackness);
-        solutions.sort_by_depth();
-        solutions.show();
-
-        if (linear) {
-            auto root_inverse =
-                block_solver_F2Lm1::initialize(scramble.get_inverse());
-            auto solutions_inverse =
-                block_solver_F2Lm1::solve(root_inverse, max_depth, slackness);
-            solutions_inverse.sort_by_depth();
-            solutions_inverse.show(true);
-        }
-    } else if (strcmp(argv[1], "multistep") == 0) {
-        auto solutions = multistep(scramble, max_depth, breadth, slackness);
+    if (strcmp(step, "123") == 0) {
+        return solve_block(block_solver_123::initialize,
+                           block_solver_123::solve, scramble, max_depth,
+                           slackness, linear, options, emit);
+    } else if (strcmp(step, "222") == 0) {
+        return solve_block(block_solver_222::initialize,
+                           block_solver_222::solve, scramble, max_depth,
+                           slackness, linear, options, emit);
+    } else if (strcmp(step, "223") == 0) {
+        return solve_block(block_solver_223::initialize,
+                           block_solver_223::solve, scramble, max_depth,
+                           slackness, linear, options, emit);
+    } else if (strcmp(step, "F2L-1") == 0) {
+        return solve_block(block_solver_F2Lm1::initialize,
+                           block_solver_F2Lm1::solve, scramble, max_depth,
+                           slackness, linear, options, emit);
+    } else if (strcmp(step, "multistep") == 0) {
+        auto solutions = multistep(scramble, max_depth, breadth, slackness,
+                                   options.n_threads);
 
-        for (auto&& node : solutions) {
-            std::cout << "----------------" << std::endl;
-            node->get_skeleton({"2x2x2", "2x2x3", "F2L-1"}).show();
+        return [solutions](std::ostream& out) {
+            for (auto&& node : solutions) {
+                out << "----------------" << std::endl;
+                write_skeleton(out, node, {"2x2x2", "2x2x3", "F2L-1"});
+            }
+        };
+    } else if (strcmp(step, "two_gen_finish") == 0) {
+        if (!two_gen::two_gen_symmetry(CubieCube(scramble))) {
+            return [](std::ostream& out) {
+                out << "The scramble is not two gen from any rotation"
+                    << std::endl;
+            };
         }
-    } else if (strcmp(argv[1], "two_gen_finish") == 0) {
         unsigned max_depth = get_option("-M", argc, argv, 20);
-        auto root = two_gen::initialize(scramble);
-
-        auto solutions = two_gen::solve(root, max_depth, slackness);
-
-        solutions.sort_by_depth();
-        solutions.show();
-
-    } else if (strcmp(argv[1], "two_gen_reduction") == 0) {
-        auto root = two_gen_reduction::initialize(scramble);
-        auto solutions = two_gen_reduction::solve(root, max_depth, slackness);
-        solutions.sort_by_depth();
-        solutions.show();
-
-        if (linear) {
-            auto root_inverse =
-                two_gen_reduction::initialize(scramble.get_inverse());
-            auto solutions_inverse =
-                two_gen_reduction::solve(root_inverse, max_depth, slackness);
-            solutions_inverse.sort_by_depth();
-            solutions_inverse.show(true);
-        }
-    } else if (strcmp(argv[1], "two_gen") == 0) {
+        return solve_block(two_gen::initialize, two_gen::solve, scramble,
+                           max_depth, slackness, linear, options, emit);
+
+    } else if (strcmp(step, "two_gen_reduction") == 0) {
+        return solve_block(two_gen_reduction::initialize,
+                           two_gen_reduction::solve, scramble, max_depth,
+                           slackness, linear, options, emit);
+    } else if (strcmp(step, "two_gen") == 0) {
         unsigned max_depth = get_option("-M", argc, argv, 25);
         two_gen::load_tables();
         two_gen_reduction::load_tables();
 
         auto root = std::make_shared<StepNode>(scramble);
-        auto solutions = reduction({root}, max_depth, breadth, slackness);
-        for (auto&& node : solutions) {
-            std::cout << "----------------" << std::endl;
-            node->get_skeleton({"Reduction", "2-Gen Finish"}).show();
+        auto solutions = reduction({root}, max_depth, breadth, slackness,
+                                   options.n_threads);
+
+        return [solutions](std::ostream& out) {
+            for (auto&& node : solutions) {
+                out << "----------------" << std::endl;
+                write_skeleton(out, node, {"Reduction", "2-Gen Finish"});
+            }
+        };
+    }
+    return [](std::ostream&) {};
+}
+
+Report solve_scramble(const char* step, const Algorithm& scramble, int argc,
+                      const char* argv[], const SearchOptions& options,
+                      const ReportSink& emit) {
+    // With --time <milliseconds> or --nodes <nodes>, the searches of the
+    // scramble stop when the budget runs out and the solutions found so far
+    // are marked as not proven optimal
+    unsigned time = get_option("--time", argc, argv, 0);
+    const char* nodes = get_string_option("--nodes", argc, argv);
+    if (time == 0 && nodes == nullptr) {
+        return solve_step(step, scramble, argc, argv, options, emit);
+    }
+
+    SearchBudget budget;
+    if (time > 0) {
+        budget.deadline =
+            SearchBudget::clock::now() + std::chrono::milliseconds(time);
+    }
+    if (nodes != nullptr) budget.max_nodes = std::strtoul(nodes, nullptr, 10);
+    BudgetWith spend(budget);
+    auto report = solve_step(step, scramble, argc, argv, options, emit);
+    if (!budget.is_stopped()) return report;
+    return [report](std::ostream& out) {
+        report(out);
+        out << "Search budget exhausted: not proven optimal" << std::endl;
+    };
+}
+
+Report solve_with_stats(const char* step, const Algorithm& scramble,
+                        int argc, const char* argv[],
+                        const SearchOptions& options, const ReportSink& emit) {
+    // Counts what the searches of this scramble cost and prints it after the
+    // solutions (--stats)
+    SearchStats stats;
+    CollectStats collect(stats);
+    auto report = solve_scramble(step, scramble, argc, argv, options, emit);
+    return [report, stats](std::ostream& out) {
+        report(out);
+        stats.show(out);
+    };
+}
+
+int serve_requests(int argc, const char* argv[], SearchOptions options) {
+    // block_solver serve (--socket <path> | --port <port>) [-j <workers>]
+    // [--preload <steps>]: solves the requests of the clients with the
+    // tables loaded once, see serve.hpp
+#ifdef BLOCK_SOLVER_SERVE
+    const char* path = get_string_option("--socket", argc, argv);
+    unsigned port = get_option("--port", argc, argv, 0);
+    if (path == nullptr && port == 0) {
+        std::cerr << "serve: --socket <path> or --port <port> is required"
+                  << std::endl;
+        return 1;
+    }
+
+    // The requests are solved side by side, each by one thread
+    options.n_threads = 1;
+    auto solve = [options](const std::vector<std::string>& args,
+                           const ReportSink& emit) {
+        if (!is_step(args[0].c_str())) {
+            throw std::invalid_argument("invalid step " + args[0]);
+        }
+        Algorithm scramble(args.back());
+        check_scramble(args[0], scramble);
+        std::vector<const char*> request_argv{"block_solver"};
+        for (auto&& arg : args) {
+            request_argv.push_back(arg.c_str());
+        }
+        return solve_scramble(args[0].c_str(), scramble, request_argv.size(),
+                              request_argv.data(), options, emit);
+    };
+
+    // Steps whose tables are loaded before the first request, by solving
+    // the solved cube
+    const char* preload = get_string_option("--preload", argc, argv);
+    if (preload != nullptr) {
+        for (auto&& step : split_fields(preload, ',')) {
+            solve({step, ""}, nullptr);
         }
-    } else {
-        std::cout << "Invalid argument: " << argv[1] << std::endl;
     }
 
+    int fd = path != nullptr ? listen_unix(path) : listen_tcp(port);
+    if (fd < 0) {
+        std::cerr << "serve: cannot listen: " << std::strerror(errno)
+                  << std::endl;
+        return 1;
+    }
+    unsigned n_workers = get_option(
+        "-j", argc, argv, std::max(1u, std::thread::hardware_concurrency()));
+    std::cout << "Listening on "
+              << (path != nullptr ? path : "port " + std::to_string(port))
+              << std::endl;
+    return serve(fd, solve, n_workers);
+#else
+    std::cerr << "serve is not supported on this platform" << std::endl;
+    return 1;
+#endif
+}
+
+int main(int argc, const char* argv[]) {
+    const char* step = argv[1];
+    bool serving = strcmp(step, "serve") == 0;
+    if (!is_step(step) && !serving) {
+        std::cout << "Invalid argument: " << step << std::endl;
+        return 0;
+    }
+
+    // SIMD kernels are used when the CPU supports them, unless --scalar
+    if (find_option("--scalar", argc, argv)) {
+        simd_level = SimdLevel::scalar;
+    }
+
+    SearchOptions options;
+    options.prefetch = !find_option("--no-prefetch", argc, argv);
+    if (serving) return serve_requests(argc, argv, options);
+    auto solve = find_option("--stats", argc, argv) ? solve_with_stats
+                                                    : solve_scramble;
+
+    // Batch mode: every scramble of the file (or of stdin with "-f -") is
+    // solved by the same process, so the tables are only loaded once
+    const char* batch_path = get_string_option("-f", argc, argv);
+    unsigned n_threads = get_option("-j", argc, argv, 1);
+    if (batch_path == nullptr) {
+        // A single scramble: the -j threads share the IDA* iterations
+        options.n_threads = n_threads;
+        // and the solutions of the block steps are printed as they are found
+        auto print = [](const Report& report) { report(std::cout); };
+        solve(step, Algorithm(argv[argc - 1]), argc, argv, options,
+              print)(std::cout);
+        return 0;
+    }
+
+    // The scrambles are spread over -j worker threads which all share the
+    // same tables
+    run_batch(
+        read_batch(batch_path),
+        [step, argc, argv, options, solve](const BatchEntry& entry) {
+            return solve(step, Algorithm(entry.scramble), argc, argv, options,
+                         nullptr);
+        },
+        n_threads);
     return 0;
-}
\ No newline at end of file
+}
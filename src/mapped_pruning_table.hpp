@@ -0,0 +1,184 @@
+#pragma once
+#include <cstdint>     // uint8_t
+#include <filesystem>  // locate pruning table files
+#include <iostream>
+#include <string>
+
+#include "move.hpp"           // HTM_Moves
+#include "search_stats.hpp"   // count_table_hit
+#include "table_storage.hpp"  // mapped table files
+
+// The largest pruning tables (F2L-1 and two_gen_reduction) are stored modulo
+// 3 when the project is configured with -DBLOCK_SOLVER_MOD3_TABLES=ON
+#ifdef BLOCK_SOLVER_MOD3_TABLES
+constexpr bool use_mod3_tables = true;
+#else
+constexpr bool use_mod3_tables = false;
+#endif
+
+inline constexpr char ptable_extension[] = ".ptable";
+inline constexpr char mod3_extension[] = ".mod3";
+
+template <unsigned bits, const char* extension>
+struct PackedTable {
+    // n_entries entries of `bits` bits, packed in bytes and stored in
+    // pruning_tables/<id><extension> after a versioned header. The file is
+    // mapped read-only when the table is loaded, so that large tables are
+    // available immediately and their pages are shared between the processes
+    // solving with them.
+    static constexpr unsigned format_version = 1;
+    static constexpr unsigned per_byte = 8 / bits;
+    static constexpr unsigned mask = (1u << bits) - 1;
+    std::size_t n_entries;
+    TableStorage<uint8_t> table;
+
+    PackedTable(const std::size_t n_entries)
+        : n_entries{n_entries},
+          table{(n_entries + per_byte - 1) / per_byte} {}
+
+    static std::filesystem::path table_path(const std::string& id) {
+        return std::filesystem::current_path() / "pruning_tables" /
+               (id + extension);
+    }
+
+    TableHeader header() const {
+        TableHeader header;
+        header.version = format_version;
+        header.bits_per_entry = bits;
+        header.n_entries = n_entries;
+        return header;
+    }
+
+    bool load(const std::string& id) {
+        // A file of another format or size is not loaded, so that the table
+        // is generated again instead of being read with the wrong layout
+        auto path = table_path(id);
+        if (table.map(path, header())) return true;
+        if (std::filesystem::exists(path)) {
+            std::cout << "Pruning table file " << path
+                      << " has another format, ignoring it" << std::endl;
+        }
+        return false;
+    }
+
+    void write(const std::string& id) const {
+        std::filesystem::create_directories(table_path(id).parent_path());
+        table.write(table_path(id), header());
+    }
+
+    void clear() {
+        table.allocate();
+        for (std::size_t i = 0; i < table.size(); ++i) {
+            table[i] = 0;
+        }
+    }
+
+    void set(const std::size_t i, const unsigned value) {
+        // Only after clear(): the bits of the entry are or-ed in
+        table[i / per_byte] |= value << (bits * (i % per_byte));
+    }
+
+    unsigned get(const std::size_t i) const {
+        return (table[i / per_byte] >> (bits * (i % per_byte))) & mask;
+    }
+
+    void prefetch(const std::size_t i) const { table.prefetch(i / per_byte); }
+};
+
+struct NibbleTable : PackedTable<4, ptable_extension> {
+    // Pruning table with 4 bits per entry: the depth of the entry, which is
+    // at most 15 for all the blocks
+    static constexpr unsigned max_value = 15;
+
+    using PackedTable::PackedTable;
+
+    template <typename Table>
+    void assign(const Table& generated) {
+        // Packs the entries of a table generated in memory. Larger values
+        // are stored as max_value, which is still a lower bound.
+        clear();
+        for (std::size_t i = 0; i < n_entries; ++i) {
+            unsigned value = generated.estimate(i);
+            set(i, value < max_value ? value : max_value);
+        }
+    }
+
+    uint8_t operator[](const std::size_t i) const { return get(i); }
+    uint8_t estimate(const std::size_t i) const {
+        uint8_t value = get(i);
+        count_table_hit(value);
+        return value;
+    }
+};
+
+template <std::size_t N>
+struct MappedPruningTable : NibbleTable {
+    MappedPruningTable() : NibbleTable(N) {}
+};
+
+inline unsigned depth_from_residue(const unsigned parent_depth,
+                                   const unsigned residue) {
+    // The depth of a child is one less, equal or one more than the depth of
+    // its parent, only one of them has the given residue modulo 3
+    return parent_depth + 1 - (parent_depth + 4 - residue) % 3;
+}
+
+struct Mod3Table : PackedTable<2, mod3_extension> {
+    // Pruning table with 2 bits per entry: the depth of the entry modulo 3.
+    // The depth itself is rebuilt from the depth of the parent node, and the
+    // depth of a root by walking down to a solved state.
+    using PackedTable::PackedTable;
+
+    template <typename Table>
+    void assign(const Table& generated) {
+        clear();
+        for (std::size_t i = 0; i < n_entries; ++i) {
+            set(i, generated.estimate(i) % 3);
+        }
+    }
+
+    unsigned residue(const std::size_t i) const { return get(i); }
+
+    unsigned depth(const std::size_t i, const unsigned parent_depth) const {
+        unsigned value = depth_from_residue(parent_depth, get(i));
+        count_table_hit(value);
+        return value;
+    }
+
+    template <typename Cube, typename Mover, typename Indexer,
+              typename SolveCheck>
+    unsigned root_depth(Cube cube, const Mover& apply, const Indexer& index,
+                        const SolveCheck& is_solved) const {
+        // Walks down to a solved state through the neighbours whose residue
+        // is one less, which are exactly the neighbours one move closer. A
+        // state without such a neighbour means the table is corrupted: the
+        // walk stops there instead of looping forever.
+        unsigned depth = 0;
+        while (!is_solved(cube)) {
+            unsigned target = (residue(index(cube)) + 2) % 3;
+            bool found = false;
+            for (Move move : HTM_Moves) {
+                Cube next = cube;
+                apply(move, next);
+                if (residue(index(next)) == target) {
+                    cube = next;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                std::cerr << "Corrupted mod 3 pruning table: no neighbour of "
+                          << index(cube) << " is closer to solved"
+                          << std::endl;
+                break;
+            }
+            ++depth;
+        }
+        return depth;
+    }
+};
+
+template <std::size_t N>
+struct Mod3PruningTable : Mod3Table {
+    Mod3PruningTable() : Mod3Table(N) {}
+};
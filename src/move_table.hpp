@@ -1,61 +1,72 @@
 #pragma once
-#include <cassert>     // assert
-#include <filesystem>  // locate move table files
-#include <fstream>     // write tabes into files
-#include <memory>      // std::unique_ptr
-#include <tuple>       // return ccl and ccp at the same time
+#include <array>        // coordinate arrays
+#include <cassert>      // assert
+#include <cstdint>      // table entry types
+#include <filesystem>   // locate move table files
+#include <tuple>        // return ccl and ccp at the same time
+#include <type_traits>  // std::conditional_t
 
 #include "algorithm.hpp"  // apply Algorithm
 #include "block.hpp"
+#include "table_generation.hpp"  // parallel_chunks
+#include "table_storage.hpp"     // mapped table files
 
 namespace fs = std::filesystem;
-template <typename value_type>
-void load_binary(const std::filesystem::path& table_path, value_type* ptr,
-                 size_t size) {
-    std::ifstream istrm(table_path, std::ios::binary);
-    istrm.read(reinterpret_cast<char*>(ptr), sizeof(value_type) * size);
-    istrm.close();
-}
-
-template <typename value_type>
-void write_binary(const std::filesystem::path& table_path, value_type* ptr,
-                  size_t size) {
-    std::ofstream file(table_path, std::ios::binary);
-    file.write(reinterpret_cast<char*>(ptr), sizeof(value_type) * size);
-    file.close();
-}
+
+// Smallest unsigned type holding the values 0 to n_values - 1, used for the
+// entries of the move tables. The table files are stored with the same type.
+template <std::size_t n_values>
+using table_entry_t = std::conditional_t<
+    (n_values <= (1u << 8)), uint8_t,
+    std::conditional_t<(n_values <= (1u << 16)), uint16_t, uint32_t>>;
 
 template <unsigned nc, unsigned ne>
 struct BlockMoveTable {
+    static constexpr unsigned n_corners = nc;
+    static constexpr unsigned n_edges = ne;
+
     static constexpr unsigned n_cl = binomial(NC, nc);
     static constexpr unsigned n_cp = factorial(nc);
     static constexpr unsigned cp_table_size = n_cp * n_cl * N_HTM_MOVES;
-    std::unique_ptr<unsigned[]> cp_table{new unsigned[cp_table_size]};
+    using cp_entry = table_entry_t<n_cl * n_cp>;
+    TableStorage<cp_entry> cp_table{cp_table_size};
 
     static constexpr unsigned n_co = ipow(3, nc);
     static constexpr unsigned co_table_size = n_cl * n_co * N_HTM_MOVES;
-    std::unique_ptr<unsigned[]> co_table{new unsigned[co_table_size]};
+    using co_entry = table_entry_t<n_co>;
+    TableStorage<co_entry> co_table{co_table_size};
 
     static constexpr unsigned n_el = binomial(NE, ne);
     static constexpr unsigned n_ep = factorial(ne);
     static constexpr unsigned ep_table_size = n_ep * n_el * N_HTM_MOVES;
-    std::unique_ptr<unsigned[]> ep_table{new unsigned[ep_table_size]};
+    using ep_entry = table_entry_t<n_el * n_ep>;
+    TableStorage<ep_entry> ep_table{ep_table_size};
 
     static constexpr unsigned n_eo = ipow(2, ne);
     static constexpr unsigned eo_table_size = n_el * n_eo * N_HTM_MOVES;
-    std::unique_ptr<unsigned[]> eo_table{new unsigned[eo_table_size]};
+    using eo_entry = table_entry_t<n_eo>;
+    TableStorage<eo_entry> eo_table{eo_table_size};
+
+    // Layout coordinates alone, used to move packed cubes. They are derived
+    // from the permutation tables rather than stored on disk.
+    using cl_entry = table_entry_t<n_cl>;
+    using el_entry = table_entry_t<n_el>;
+    TableStorage<cl_entry> cl_table{n_cl * N_HTM_MOVES};
+    TableStorage<el_entry> el_table{n_el * N_HTM_MOVES};
+
+    // Rows handed out at a time to the threads that build the tables
+    static constexpr std::size_t move_table_chunk = 1 << 10;
 
     BlockMoveTable() {}
-    BlockMoveTable(Block<nc, ne>& b) {
+    BlockMoveTable(const Block<nc, ne>& b) {
         auto table_path = block_table_path(b);
-        if (fs::exists(table_path)) {
-            this->load(table_path);
-        } else {
+        if (!this->load(table_path)) {
             std::cout
                 << "Move table directory not found, building the tables\n";
-            compute_corner_move_tables(b);
-            compute_edge_move_tables(b);
+            compute_corner_move_tables();
+            compute_edge_move_tables();
             this->write(table_path);
+            this->load(table_path);
         }
     }
 
@@ -82,6 +93,23 @@ struct BlockMoveTable {
         }
     }
 
+    void apply(const unsigned move, PackedBlockCube& cube) const {
+        // The orientation tables are indexed by the layout before the move
+        if constexpr (nc > 0) {
+            cube.cco =
+                co_table[N_HTM_MOVES * (cube.ccl * n_co + cube.cco) + move];
+            cube.cclp = cp_table[N_HTM_MOVES * cube.cclp + move];
+            cube.ccl = cl_table[N_HTM_MOVES * cube.ccl + move];
+        }
+
+        if constexpr (ne > 0) {
+            cube.ceo =
+                eo_table[N_HTM_MOVES * (cube.cel * n_eo + cube.ceo) + move];
+            cube.celp = ep_table[N_HTM_MOVES * cube.celp + move];
+            cube.cel = el_table[N_HTM_MOVES * cube.cel + move];
+        }
+    }
+
     void apply_inverse(const unsigned& move, CoordinateBlockCube& cbc) const {
         apply(inverse_of_HTM_Moves[move], cbc);
     }
@@ -104,6 +132,11 @@ struct BlockMoveTable {
         apply(move_conj(move, sym_index), cube);
     }
 
+    auto sym_apply(const Move& move, const unsigned& sym_index,
+                   PackedBlockCube& cube) const {
+        apply(move_conj(move, sym_index), cube);
+    }
+
     auto sym_apply(const Algorithm& alg, const unsigned& sym_index,
                    CoordinateBlockCube& cube) const {
         for (auto move : alg.sequence) {
@@ -164,130 +197,198 @@ struct BlockMoveTable {
         std::filesystem::path ep_table_file = table_path / "ep_table.dat";
         std::filesystem::path eo_table_file = table_path / "eo_table.dat";
 
-        write_binary<unsigned>(cp_table_file, cp_table.get(), cp_table_size);
-        write_binary<unsigned>(co_table_file, co_table.get(), co_table_size);
-        write_binary<unsigned>(ep_table_file, ep_table.get(), ep_table_size);
-        write_binary<unsigned>(eo_table_file, eo_table.get(), eo_table_size);
-    }
-
-    void load(const std::filesystem::path& table_path) const {
-        assert(fs::exists(table_path));
-        std::filesystem::path cp_table_path = table_path / "cp_table.dat";
-        std::filesystem::path co_table_path = table_path / "co_table.dat";
-        std::filesystem::path ep_table_path = table_path / "ep_table.dat";
-        std::filesystem::path eo_table_path = table_path / "eo_table.dat";
-
-        load_binary<unsigned>(cp_table_path, cp_table.get(), cp_table_size);
-        load_binary<unsigned>(co_table_path, co_table.get(), co_table_size);
-        load_binary<unsigned>(ep_table_path, ep_table.get(), ep_table_size);
-        load_binary<unsigned>(eo_table_path, eo_table.get(), eo_table_size);
-    }
-
-    void compute_edge_move_tables(Block<nc, ne>& b) {
-        CubieCube cc, cc_copy;
-        CoordinateBlockCube cbc;
-
-        unsigned p_idx = 0, o_idx = 0, m_idx = 0;
-        for (unsigned il = 0; il < n_el; il++) {
-            // Loop for the permutation coordinate
-            for (unsigned ip = 0; ip < n_ep; ip++) {
-                m_idx = 0;
-                cbc.set(0, il, 0, ip, 0, 0);
-                cc = b.to_cubie_cube(cbc);
-                for (auto&& move_idx : HTM_Moves) {
-                    auto move = move_cc[move_idx];
-                    cc_copy = cc;
-                    cc_copy.edge_apply(move);
-                    cbc = b.to_coordinate_block_cube(cc_copy);
-                    assert(N_HTM_MOVES * (cbc.cel * n_ep + cbc.cep) <
-                           ep_table_size);
-                    assert(p_idx * N_HTM_MOVES + m_idx < ep_table_size);
-                    ep_table[p_idx * N_HTM_MOVES + m_idx] =
-                        cbc.cel * n_ep + cbc.cep;
-                    m_idx++;
-                }
-                p_idx++;
+        cp_table.write(cp_table_file);
+        co_table.write(co_table_file);
+        ep_table.write(ep_table_file);
+        eo_table.write(eo_table_file);
+    }
+
+    bool load(const std::filesystem::path& table_path) {
+        // Maps the table files, returns false if one of them is missing or
+        // has the wrong size
+        bool mapped = cp_table.map(table_path / "cp_table.dat") &&
+                      co_table.map(table_path / "co_table.dat") &&
+                      ep_table.map(table_path / "ep_table.dat") &&
+                      eo_table.map(table_path / "eo_table.dat");
+        if (mapped) {
+            compute_corner_layout_table();
+            compute_edge_layout_table();
+        }
+        return mapped;
+    }
+
+    // The layout after a move does not depend on the permutation, so the
+    // layout tables are read from the entries of permutation 0
+    void compute_corner_layout_table() {
+        for (unsigned il = 0; il < n_cl; ++il) {
+            for (unsigned move = 0; move < N_HTM_MOVES; ++move) {
+                cl_table[N_HTM_MOVES * il + move] =
+                    cp_table[N_HTM_MOVES * il * n_cp + move] / n_cp;
             }
-            for (unsigned io = 0; io < n_eo;
-                 io++)  // Loop for the orientation coordinate
-            {
-                m_idx = 0;
-                cbc.set(0, il, 0, 0, 0, io);
-                cc = b.to_cubie_cube(cbc);
-                for (auto&& move_idx : HTM_Moves) {
-                    auto move = move_cc[move_idx];
-                    cc_copy = cc;
-                    cc_copy.edge_apply(move);
-                    cbc = b.to_coordinate_block_cube(cc_copy);
-                    assert(N_HTM_MOVES * (cbc.cel * n_eo + cbc.ceo) <
-                           eo_table_size);
-                    assert(o_idx * N_HTM_MOVES + m_idx < eo_table_size);
-                    eo_table[o_idx * N_HTM_MOVES + m_idx] = cbc.ceo;
-                    m_idx++;
-                }
-                o_idx++;
+        }
+    }
+
+    void compute_edge_layout_table() {
+        for (unsigned il = 0; il < n_el; ++il) {
+            for (unsigned move = 0; move < N_HTM_MOVES; ++move) {
+                el_table[N_HTM_MOVES * il + move] =
+                    ep_table[N_HTM_MOVES * il * n_ep + move] / n_ep;
             }
         }
     }
 
-    void compute_corner_move_tables(Block<nc, ne>& b) {
-        Block<nc, ne> bc(b);
-        CubieCube cc, cc_copy;
-        CoordinateBlockCube cbc;
-
-        unsigned p_idx = 0, o_idx = 0, m_idx = 0;
-        for (unsigned il = 0; il < n_cl; il++) {
-            for (unsigned ip = 0; ip < n_cp; ip++) {
-                m_idx = 0;
-                cbc.set(il, 0, ip, 0, 0, 0);
-                cc = b.to_cubie_cube(cbc);
-                for (auto&& move_idx : HTM_Moves) {
-                    cc_copy = cc;
-                    auto move = move_cc[move_idx];
-                    cc_copy.corner_apply(move);
-                    cbc = b.to_coordinate_block_cube(cc_copy);
-                    assert(N_HTM_MOVES * (cbc.ccl * n_cp + cbc.ccp) <
-                           cp_table_size);
-                    assert(p_idx * N_HTM_MOVES + m_idx < cp_table_size);
-                    cp_table[p_idx * N_HTM_MOVES + m_idx] =
-                        cbc.ccl * n_cp + cbc.ccp;
-                    m_idx++;
-                }
-                p_idx++;
+    // Moves as maps of positions: after move m, position i holds the piece
+    // that was at source[m][i], twisted or flipped by orientation[m][i]. They
+    // are read once from the moves applied to the solved cube, the entries
+    // are then computed on coordinate arrays without building cubie cubes.
+    template <std::size_t N>
+    struct PositionMoves {
+        std::array<std::array<unsigned, N>, N_HTM_MOVES> source, orientation;
+    };
+
+    static PositionMoves<NC> corner_position_moves() {
+        PositionMoves<NC> moves;
+        for (Move move : HTM_Moves) {
+            CubieCube cc;
+            cc.corner_apply(move_cc[move]);
+            for (unsigned i = 0; i < NC; ++i) {
+                moves.source[move][i] = cc.cp[i];
+                moves.orientation[move][i] = cc.co[i];
             }
-            for (unsigned io = 0; io < n_co; io++) {
-                m_idx = 0;
-                cbc.set(il, 0, 0, 0, io, 0);
-                cc = bc.to_cubie_cube(cbc);
-                for (auto&& move_idx : HTM_Moves) {
-                    auto move = move_cc[move_idx];
-                    cc_copy = cc;
-                    cc_copy.corner_apply(move);
-                    cbc = bc.to_coordinate_block_cube(cc_copy);
-                    assert(N_HTM_MOVES * (cbc.ccl * n_co + cbc.cco) <
-                           co_table_size);
-                    assert(o_idx * N_HTM_MOVES + m_idx < co_table_size);
-                    co_table[o_idx * N_HTM_MOVES + m_idx] = cbc.cco;
-                    m_idx++;
+        }
+        return moves;
+    }
+
+    static PositionMoves<NE> edge_position_moves() {
+        PositionMoves<NE> moves;
+        for (Move move : HTM_Moves) {
+            CubieCube cc;
+            cc.edge_apply(move_cc[move]);
+            for (unsigned i = 0; i < NE; ++i) {
+                moves.source[move][i] = cc.ep[i];
+                moves.orientation[move][i] = cc.eo[i];
+            }
+        }
+        return moves;
+    }
+
+    template <unsigned n, std::size_t N, typename Entry>
+    static void permutation_row(const unsigned row,
+                                const PositionMoves<N>& moves,
+                                TableStorage<Entry>& table) {
+        // Entries of the layout and permutation row / n!, row % n!
+        constexpr unsigned n_p = factorial(n);
+        std::array<unsigned, N> layout;
+        std::array<unsigned, n> perm;
+        std::array<unsigned, N> piece;  // block piece at each position, or n
+        layout_from_index(row / n_p, layout, n);
+        if constexpr (n > 0) permutation_from_index(row % n_p, perm);
+        for (unsigned i = 0, k = 0; i < N; ++i) {
+            piece[i] = layout[i] ? perm[k++] : n;
+        }
+        for (unsigned move = 0; move < N_HTM_MOVES; ++move) {
+            for (unsigned i = 0, k = 0; i < N; ++i) {
+                unsigned p = piece[moves.source[move][i]];
+                layout[i] = p < n;
+                if (p < n) perm[k++] = p;
+            }
+            unsigned entry = layout_index(layout, n) * n_p;
+            if constexpr (n > 0) entry += permutation_index(perm);
+            table[N_HTM_MOVES * row + move] = entry;
+        }
+    }
+
+    template <unsigned n, unsigned n_ori, std::size_t N, typename Entry>
+    static void orientation_row(const unsigned row,
+                                const PositionMoves<N>& moves,
+                                TableStorage<Entry>& table) {
+        // Entries of the layout and orientation row / n_ori^n, row % n_ori^n
+        constexpr unsigned n_o = ipow(n_ori, n);
+        std::array<unsigned, N> layout;
+        std::array<unsigned, N> position_ori{};
+        layout_from_index(row / n_o, layout, n);
+        unsigned o = row % n_o;
+        for (unsigned i = 0; i < N; ++i) {
+            if (layout[i]) {
+                position_ori[i] = o % n_ori;
+                o /= n_ori;
+            }
+        }
+        for (unsigned move = 0; move < N_HTM_MOVES; ++move) {
+            unsigned index = 0, weight = 1;
+            for (unsigned i = 0; i < N; ++i) {
+                unsigned from = moves.source[move][i];
+                if (layout[from]) {
+                    index += weight * ((position_ori[from] +
+                                        moves.orientation[move][i]) %
+                                       n_ori);
+                    weight *= n_ori;
                 }
-                o_idx++;
             }
+            table[N_HTM_MOVES * row + move] = index;
         }
     }
+
+    void compute_edge_move_tables() {
+        // Each row (layout and permutation, or layout and orientation) is
+        // decoded once and moved 18 times, the rows are split between threads
+        ep_table.allocate();
+        eo_table.allocate();
+        const auto moves = edge_position_moves();
+        parallel_chunks(
+            n_el * n_ep, generation_threads(),
+            [&](std::size_t begin, std::size_t end, unsigned) {
+                for (std::size_t row = begin; row < end; ++row) {
+                    permutation_row<ne>(row, moves, ep_table);
+                }
+            },
+            move_table_chunk);
+        parallel_chunks(
+            n_el * n_eo, generation_threads(),
+            [&](std::size_t begin, std::size_t end, unsigned) {
+                for (std::size_t row = begin; row < end; ++row) {
+                    orientation_row<ne, 2>(row, moves, eo_table);
+                }
+            },
+            move_table_chunk);
+        compute_edge_layout_table();
+    }
+
+    void compute_corner_move_tables() {
+        cp_table.allocate();
+        co_table.allocate();
+        const auto moves = corner_position_moves();
+        parallel_chunks(
+            n_cl * n_cp, generation_threads(),
+            [&](std::size_t begin, std::size_t end, unsigned) {
+                for (std::size_t row = begin; row < end; ++row) {
+                    permutation_row<nc>(row, moves, cp_table);
+                }
+            },
+            move_table_chunk);
+        parallel_chunks(
+            n_cl * n_co, generation_threads(),
+            [&](std::size_t begin, std::size_t end, unsigned) {
+                for (std::size_t row = begin; row < end; ++row) {
+                    orientation_row<nc, 3>(row, moves, co_table);
+                }
+            },
+            move_table_chunk);
+        compute_corner_layout_table();
+    }
 };
 
 struct EOMoveTable {
     static constexpr unsigned table_size = ipow(2, NE - 1) * N_HTM_MOVES;
-    std::unique_ptr<unsigned[]> table{new unsigned[table_size]};
+    TableStorage<table_entry_t<ipow(2, NE - 1)>> table{table_size};
 
     EOMoveTable() {
-        if (fs::exists(table_path())) {
-            this->load();
-        } else {
+        if (!this->load()) {
             std::cout
                 << "EO move table directory not found, building the table\n";
             compute_table();
             this->write();
+            this->load();
         };
     }
 
@@ -295,17 +396,13 @@ struct EOMoveTable {
         return fs::current_path() / "move_tables/";
     }
     std::filesystem::path table_path() const { return table_dir_path() / "eo"; }
-    void load() const {
-        assert(fs::exists(table_path()));
-        load_binary<unsigned>(table_path() / "table.dat", table.get(),
-                              table_size);
-    }
+    bool load() { return table.map(table_path() / "table.dat"); }
     void write() const {
         fs::create_directories(table_path());
-        write_binary<unsigned>(table_path() / "table.dat", table.get(),
-                               table_size);
+        table.write(table_path() / "table.dat");
     }
     void compute_table() {
+        table.allocate();
         CubieCube cube, tmp;
 
         for (unsigned eo_c = 0; eo_c < ipow(2, NE - 1); ++eo_c) {
@@ -330,6 +427,11 @@ struct EOMoveTable {
         cube.ceo = table[cube.ceo * N_HTM_MOVES + move];
     }
 
+    auto apply(const Move& move, PackedBlockCube& cube) const {
+        assert(cube.ceo * N_HTM_MOVES + move < table_size);
+        cube.ceo = table[cube.ceo * N_HTM_MOVES + move];
+    }
+
     auto apply(const Algorithm& alg, CoordinateBlockCube& cube) const {
         for (auto move : alg.sequence) {
             apply(move, cube);
@@ -352,6 +454,11 @@ struct EOMoveTable {
         apply(move_conj(move, sym_index), cube);
     }
 
+    auto sym_apply(const Move& move, const unsigned& sym_index,
+                   PackedBlockCube& cube) const {
+        apply(move_conj(move, sym_index), cube);
+    }
+
     auto sym_apply(const Algorithm& alg, const unsigned& sym_index,
                    CoordinateBlockCube& cube) const {
         for (auto move : alg.sequence) {
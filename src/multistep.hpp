@@ -1,25 +1,274 @@
 #pragma once
+#include <algorithm>    // std::min, std::max
+#include <array>        // state keys
+#include <climits>      // UINT_MAX
+#include <cstdint>      // uint8_t
+#include <functional>   // std::function
+#include <iterator>     // std::prev
+#include <map>          // solutions by state, queue of the skeletons
+#include <memory>       // std::shared_ptr
+#include <mutex>        // entries shared by the threads
+#include <tuple>        // queue keys
+#include <type_traits>  // std::invoke_result_t, std::decay_t
+#include <utility>      // std::declval
+
 #include "222.hpp"
 #include "223.hpp"
 #include "F2L-1.hpp"
+#include "parallel_steps.hpp"  // parallel_map
 #include "step_node.hpp"
 
-auto make_step_three = make_stepper(block_solver_F2Lm1::cc_initialize,
-                                    block_solver_F2Lm1::solve, STEPFINAL{});
-auto make_step_two = make_stepper(block_solver_223::cc_initialize,
-                                  block_solver_223::solve, make_step_three);
-auto make_step_one = make_stepper(block_solver_222::cc_initialize,
-                                  block_solver_222::solve, make_step_two);
+template <typename Initializer, typename Solver>
+class StepCache {
+    // Solutions of a step by starting state, kept for one multistep search.
+    // Skeletons which reach the same state share its searches.
+    // Every state remembers up to which length it has been searched, so that
+    // when multistep asks for longer solutions only the new lengths are
+    // searched. A state gets the solutions a single search up to max_depth
+    // would return, in the same order. Several threads may use the cache:
+    // the searches of one state run one at a time, those of different states
+    // side by side.
+    using Root = std::invoke_result_t<Initializer, const CubieCube&>;
+    using Solutions = decltype(std::declval<Solver>()(
+        std::declval<Root>(), 0, 0, SearchOptions{}));
+    using Key = std::array<uint8_t, 40>;
+
+    struct Entry {
+        std::mutex mutex;  // held while the state is searched
+        bool initialized = false;
+        Root root;
+        Solutions solutions;           // by nondecreasing length
+        unsigned next_bound = 0;       // every shorter solution is known
+        unsigned optimal = UINT_MAX;   // length of the shortest one, if any
+        unsigned estimate = UINT_MAX;  // lower bound of the root, once known
+    };
+
+    Initializer initialize;
+    Solver solve;
+    std::map<Key, Entry> entries;
+    std::mutex entries_mutex;
+
+    static Key key(const CubieCube& cc) {
+        Key key;
+        for (unsigned k = 0; k < 8; ++k) {
+            key[k] = cc.cp[k];
+            key[8 + k] = cc.co[k];
+        }
+        for (unsigned k = 0; k < 12; ++k) {
+            key[16 + k] = cc.ep[k];
+            key[28 + k] = cc.eo[k];
+        }
+        return key;
+    }
+
+    Entry& find(const CubieCube& cc) {
+        // The entry of cc, to be locked and initialized by the caller. The
+        // entries of a std::map do not move when others are added.
+        std::lock_guard<std::mutex> lock(entries_mutex);
+        return entries[key(cc)];
+    }
+
+    Entry& lock(std::unique_lock<std::mutex>& lock, const CubieCube& cc) {
+        Entry& entry = find(cc);
+        lock = std::unique_lock<std::mutex>(entry.mutex);
+        if (!entry.initialized) {
+            entry.root = initialize(cc);
+            entry.initialized = true;
+        }
+        return entry;
+    }
+
+   public:
+    StepCache(const Initializer& initialize, const Solver& solve)
+        : initialize{initialize}, solve{solve} {}
+
+    unsigned lower_bound(const CubieCube& cc) {
+        // Estimate of the pruning tables, no solution is shorter
+        std::unique_lock<std::mutex> locked;
+        Entry& entry = lock(locked, cc);
+        if (entry.estimate == UINT_MAX) {
+            SearchOptions options;
+            options.root_estimate = &entry.estimate;
+            solve(entry.root, 0, 0, options);
+        }
+        return entry.estimate;
+    }
+
+    unsigned max_length(const CubieCube& cc, const unsigned slackness) {
+        // No solution is longer, UINT_MAX until the shortest one is found
+        std::unique_lock<std::mutex> locked;
+        Entry& entry = lock(locked, cc);
+        return entry.optimal == UINT_MAX ? UINT_MAX
+                                         : entry.optimal + slackness;
+    }
+
+    Solutions operator()(const CubieCube& cc, const unsigned max_depth,
+                         const unsigned slackness) {
+        std::unique_lock<std::mutex> locked;
+        Entry& entry = lock(locked, cc);
+
+        // Nothing is longer than optimal + slackness
+        unsigned last = entry.optimal == UINT_MAX
+                            ? max_depth
+                            : std::min(max_depth, entry.optimal + slackness);
+        Solutions found;
+        if (entry.next_bound <= last) {
+            SearchOptions options;
+            options.first_bound = entry.next_bound;
+            found = solve(entry.root, last, slackness, options);
+        }
+
+        Solutions ret;
+        for (auto&& node : entry.solutions) {
+            if (node->depth > max_depth) break;
+            ret.push_back(node);
+        }
+        ret.insert(ret.end(), found.begin(), found.end());
+        // A search stopped by its budget may have missed some solutions
+        if (entry.next_bound <= last && !search_stopped()) {
+            if (!found.empty() && entry.optimal == UINT_MAX) {
+                entry.optimal = found.front()->depth;
+            }
+            entry.solutions.insert(entry.solutions.end(), found.begin(),
+                                   found.end());
+            entry.next_bound = last + 1;
+        }
+        return ret;
+    }
+};
+
+struct MultistepStep {
+    // expand: the children of a node whose step solutions have `length`
+    // moves. lower_bound and max_length bound the length of the step
+    // solutions of a state.
+    std::function<std::vector<StepNode::sptr>(const StepNode::sptr& node,
+                                              const unsigned length)>
+        expand;
+    std::function<unsigned(const CubieCube&)> lower_bound;
+    std::function<unsigned(const CubieCube&)> max_length;
+};
+
+template <typename Initializer, typename Solver>
+auto make_multistep_step(const Initializer& initialize, const Solver& solve,
+                         const unsigned slackness) {
+    // One step of multistep, searched through a StepCache on both the normal
+    // and the inverse scramble
+    using Cache = StepCache<std::decay_t<Initializer>, std::decay_t<Solver>>;
+    auto cache = std::make_shared<Cache>(initialize, solve);
+    MultistepStep step;
+    step.expand = [cache, slackness](const StepNode::sptr& node,
+                                     const unsigned length) {
+        auto solutions = node->expand(
+            [](const CubieCube& cc) { return cc; },
+            [cache](const CubieCube& cc, const unsigned max_depth,
+                    const unsigned slackness) {
+                return (*cache)(cc, max_depth, slackness);
+            },
+            length, slackness);
+        std::vector<StepNode::sptr> children;
+        for (auto&& child : solutions) {
+            if (child->seq.size() == length) children.push_back(child);
+        }
+        return children;
+    };
+    step.lower_bound = [cache](const CubieCube& cc) {
+        return std::min(cache->lower_bound(cc),
+                        cache->lower_bound(cc.get_inverse()));
+    };
+    step.max_length = [cache, slackness](const CubieCube& cc) {
+        return std::max(cache->max_length(cc, slackness),
+                        cache->max_length(cc.get_inverse(), slackness));
+    };
+    return step;
+}
 
 auto multistep(const CubieCube& scramble, const unsigned max_depth,
-               const unsigned breadth, const unsigned slackness) {
-    auto root = std::make_shared<StepNode>(scramble);
-    auto move_budget = 0;
+               const unsigned breadth, const unsigned slackness,
+               const unsigned n_threads = 1) {
+    // Best first search of the skeletons. A partial skeleton is scored by its
+    // length plus a lower bound of its next step, and the solutions of that
+    // step are generated one length at a time, so that the first complete
+    // skeleton popped is a shortest one. The queue keeps the best `breadth`
+    // partial skeletons. The steps are made for each scramble, so that their
+    // caches only hold the states of this one.
+    //
+    // The skeletons of the best score are popped together and expanded by
+    // n_threads workers, then their children are pushed in the order of the
+    // queue, so that the result does not depend on the number of threads.
+    std::array<MultistepStep, 3> steps{
+        make_multistep_step(block_solver_222::cc_initialize,
+                            block_solver_222::solve, slackness),
+        make_multistep_step(block_solver_223::cc_initialize,
+                            block_solver_223::solve, slackness),
+        make_multistep_step(block_solver_F2Lm1::cc_initialize,
+                            block_solver_F2Lm1::solve, slackness)};
+
+    struct Partial {
+        StepNode::sptr node;
+        unsigned step;    // next step, steps.size() once complete
+        unsigned length;  // of the solutions of that step to generate
+    };
+    // By score, then the most advanced skeletons, then first pushed first
+    using Key = std::tuple<unsigned, unsigned, unsigned long>;
+    std::map<Key, Partial> queue;
+    unsigned long n_pushed = 0;
+    auto push = [&](const StepNode::sptr& node, const unsigned step,
+                    const unsigned length) {
+        unsigned score = node->depth + length;
+        if (score > max_depth) return;
+        queue.emplace(Key{score, unsigned(steps.size() - step), n_pushed++},
+                      Partial{node, step, length});
+        if (queue.size() > breadth) queue.erase(std::prev(queue.end()));
+    };
+
+    struct Expansion {
+        std::vector<StepNode::sptr> children;
+        std::vector<unsigned> lower_bounds;  // of the next step
+        bool longer = false;                 // has longer step solutions
+    };
+    auto expand = [&steps](const Partial& partial) {
+        auto& [node, k, length] = partial;
+        Expansion ret;
+        ret.children = steps[k].expand(node, length);
+        for (auto&& child : ret.children) {
+            ret.lower_bounds.push_back(
+                k + 1 < steps.size() ? steps[k + 1].lower_bound(child->state)
+                                     : 0);
+        }
+        ret.longer = length < steps[k].max_length(node->state);
+        return ret;
+    };
+
     std::vector<StepNode::sptr> solutions;
+    auto root = std::make_shared<StepNode>(scramble);
+    push(root, 0, steps[0].lower_bound(scramble));
+    while (!queue.empty() && !search_stopped()) {
+        unsigned score = std::get<0>(queue.begin()->first);
+        // Every skeleton of the shortest length has been popped
+        if (!solutions.empty() && score > solutions.front()->depth) break;
+
+        std::vector<Partial> batch;
+        while (!queue.empty() && std::get<0>(queue.begin()->first) == score) {
+            auto& partial = queue.begin()->second;
+            if (partial.step == steps.size()) {
+                solutions.push_back(partial.node);
+            } else {
+                batch.push_back(partial);
+            }
+            queue.erase(queue.begin());
+        }
 
-    while (solutions.size() == 0 && move_budget <= max_depth) {
-        solutions = make_step_one({root}, move_budget, breadth, slackness);
-        move_budget++;
+        auto expansions = parallel_map(batch.size(), n_threads, [&](size_t i) {
+            return expand(batch[i]);
+        });
+        for (size_t i = 0; i < batch.size(); ++i) {
+            auto& [node, k, length] = batch[i];
+            auto& expansion = expansions[i];
+            for (size_t c = 0; c < expansion.children.size(); ++c) {
+                push(expansion.children[c], k + 1, expansion.lower_bounds[c]);
+            }
+            if (expansion.longer) push(node, k, length + 1);
+        }
     }
     return solutions;
 }
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>    // std::stable_sort
+#include <atomic>       // next index
+#include <thread>
+#include <type_traits>  // std::invoke_result_t, std::is_invocable_v
+#include <vector>
+
+#include "search_budget.hpp"  // search_budget
+#include "search_stats.hpp"   // collected_stats
+#include "step_node.hpp"
+
+template <typename Function>
+auto parallel_map(const size_t n, unsigned n_threads, const Function& f) {
+    // Returns {f(0), ..., f(n - 1)}, computed by n_threads workers. The
+    // results are in index order whatever the scheduling. The workers spend
+    // the search budget of the calling thread, and their stats are added to
+    // the stats it collects once they are done.
+    using Result = std::invoke_result_t<Function, size_t>;
+    std::vector<Result> results(n);
+    if (n_threads > n) n_threads = n;
+    if (n_threads <= 1) {
+        for (size_t k = 0; k < n; ++k) {
+            results[k] = f(k);
+        }
+        return results;
+    }
+
+    SearchBudget* budget = search_budget;
+    std::vector<SearchStats> worker_stats(n_threads);
+    std::atomic<size_t> next{0};
+    auto worker = [&](const unsigned id) {
+        search_budget = budget;  // the thread is new, nothing to restore
+        CollectStats collect(worker_stats[id]);
+        for (size_t k = next++; k < n; k = next++) {
+            results[k] = f(k);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned id = 0; id < n_threads; ++id) {
+        workers.emplace_back(worker, id);
+    }
+    for (auto&& w : workers) {
+        w.join();
+    }
+    if (collected_stats != nullptr) {
+        for (auto&& partial : worker_stats) {
+            collected_stats->merge(partial);
+        }
+    }
+    return results;
+}
+
+template <typename Initializer, typename Solver, typename Next>
+auto make_parallel_stepper(const Initializer& initialize, const Solver& solve,
+                           const Next& next, bool niss = true) {
+    // Same as make_stepper, with the nodes of the frontier expanded by
+    // n_threads workers. Their children are merged in the order of the
+    // nodes before being sorted and cut to `breadth`, so that the result
+    // does not depend on the number of threads. The next step gets the same
+    // threads when it takes them.
+    return [initialize, solve, next, niss](
+               const std::vector<StepNode::sptr>& nodes,
+               const unsigned max_depth, const unsigned breadth,
+               const unsigned slackness, const unsigned n_threads = 1) {
+        auto expanded = parallel_map(nodes.size(), n_threads, [&](size_t k) {
+            auto& node = nodes[k];
+            if (node->depth > max_depth) return std::vector<StepNode::sptr>{};
+            return node->expand(initialize, solve, max_depth - node->depth,
+                                slackness, niss);
+        });
+
+        std::vector<StepNode::sptr> children;
+        for (auto&& c : expanded) {
+            children.insert(children.end(), c.begin(), c.end());
+        }
+        std::stable_sort(children.begin(), children.end(),
+                         [](const StepNode::sptr& a, const StepNode::sptr& b) {
+                             return a->depth < b->depth;
+                         });
+        if (children.size() > breadth) children.resize(breadth);
+
+        if constexpr (std::is_invocable_v<Next, std::vector<StepNode::sptr>,
+                                          unsigned, unsigned, unsigned,
+                                          unsigned>) {
+            return next(children, max_depth, breadth, slackness, n_threads);
+        } else {
+            return next(children, max_depth, breadth, slackness);
+        }
+    };
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>   // shared node counter and flags
+#include <chrono>   // deadline
+#include <climits>  // ULONG_MAX
+#include <utility>  // std::exchange
+
+struct SearchBudget {
+    // Limits of the searches of one solve, shared by all their threads: a
+    // deadline, a number of generated nodes and a cancellation flag. Once one
+    // of them is reached every search returns the solutions it has found so
+    // far, and `stopped` tells that they are not proven optimal.
+    using clock = std::chrono::steady_clock;
+
+    clock::time_point deadline = clock::time_point::max();
+    unsigned long max_nodes = ULONG_MAX;
+    const std::atomic<bool>* cancel = nullptr;
+    SearchBudget* parent = nullptr;  // see BudgetWith
+
+    std::atomic<unsigned long> nodes = 0;
+    std::atomic<bool> stopped = false;
+
+    bool spend(const unsigned long n) {
+        // Adds n nodes, here and to the parent whatever the limit reached,
+        // returns false once the budget has run out
+        bool in_parent = parent == nullptr || parent->spend(n);
+        bool in_nodes =
+            nodes.fetch_add(n, std::memory_order_relaxed) + n <= max_nodes;
+        if (stopped.load(std::memory_order_relaxed)) return false;
+        bool out =
+            !in_parent || !in_nodes ||
+            (cancel != nullptr && cancel->load(std::memory_order_relaxed)) ||
+            (deadline != clock::time_point::max() && clock::now() >= deadline);
+        if (out) stopped.store(true, std::memory_order_relaxed);
+        return !out;
+    }
+
+    bool is_stopped() const { return stopped.load(std::memory_order_relaxed); }
+};
+
+// Budget of the searches of the current thread, nullptr when they are not
+// limited. Like the stats, it is not passed down as an argument because the
+// steppers call the solvers without options.
+inline thread_local SearchBudget* search_budget = nullptr;
+
+struct BudgetWith {
+    // The searches run by this thread spend `budget` until it goes out of
+    // scope. A budget installed within another one also stops with it, e.g.
+    // a request of the daemon with its own time limit.
+    SearchBudget* previous;
+    BudgetWith(SearchBudget& budget)
+        : previous{std::exchange(search_budget, &budget)} {
+        budget.parent = previous;
+    }
+    ~BudgetWith() { search_budget = previous; }
+};
+
+inline bool search_stopped() {
+    // True once the budget of the current thread has run out
+    return search_budget != nullptr && !search_budget->spend(0);
+}
+
+class BudgetMeter {
+    // The nodes of one search thread, handed to the shared budget in batches
+    // so that its counter and the clock are only read every `batch` nodes
+    SearchBudget* budget;
+    unsigned long unspent = 0;
+    bool stopped = false;
+
+   public:
+    static constexpr unsigned long batch = 1 << 12;
+
+    BudgetMeter(SearchBudget* budget) : budget{budget} {}
+    BudgetMeter(const BudgetMeter&) = delete;
+    ~BudgetMeter() {
+        if (budget != nullptr) budget->spend(unspent);
+    }
+
+    bool spend(const unsigned long n) {
+        // Returns false once the budget has run out
+        if (budget != nullptr && (unspent += n) >= batch) {
+            stopped = !budget->spend(std::exchange(unspent, 0));
+        }
+        return !stopped;
+    }
+
+    bool is_stopped() const { return stopped; }
+};
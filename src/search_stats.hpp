@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>  // std::min
+#include <array>      // table hits by value
+#include <chrono>     // solution times
+#include <iostream>
+#include <map>      // nodes by iteration
+#include <utility>  // std::exchange
+
+// The search counters are compiled in with -DBLOCK_SOLVER_STATS (CMake option
+// BLOCK_SOLVER_STATS). Without it every counting method is empty and the
+// searches cost exactly what they cost without counters.
+#ifdef BLOCK_SOLVER_STATS
+constexpr bool search_stats_enabled = true;
+#else
+constexpr bool search_stats_enabled = false;
+#endif
+
+struct SearchStats {
+    // What the searches cost, collected while a CollectStats is alive on the
+    // thread that calls them
+    using clock = std::chrono::steady_clock;
+    static constexpr unsigned n_values = 32;  // larger values are clamped
+
+    unsigned long nodes = 0;  // nodes generated
+    std::map<unsigned, unsigned long> iteration_nodes;  // by IDA* bound
+    unsigned long estimate_calls = 0;
+    std::array<unsigned long, n_values> table_hits{};  // entries read, by value
+    unsigned long is_solved_checks = 0;
+    unsigned long solutions = 0;
+    clock::time_point first_solution = clock::time_point::max();
+    // End of the first iteration that found solutions
+    clock::time_point all_optimal = clock::time_point::max();
+
+    void count_nodes(const unsigned long n) {
+        if constexpr (search_stats_enabled) nodes += n;
+    }
+    void count_estimate() {
+        if constexpr (search_stats_enabled) ++estimate_calls;
+    }
+    void count_table_hit(const unsigned value) {
+        if constexpr (search_stats_enabled) {
+            ++table_hits[value < n_values ? value : n_values - 1];
+        }
+    }
+    void count_is_solved() {
+        if constexpr (search_stats_enabled) ++is_solved_checks;
+    }
+    void count_solution() {
+        if constexpr (search_stats_enabled) {
+            if (solutions++ == 0) first_solution = clock::now();
+        }
+    }
+    void end_iteration(const unsigned bound, const unsigned long start_nodes,
+                       const bool optimal) {
+        // Called after each IDA* iteration, start_nodes is the node count
+        // before it
+        if constexpr (search_stats_enabled) {
+            iteration_nodes[bound] += nodes - start_nodes;
+            if (optimal) all_optimal = clock::now();
+        }
+    }
+
+    void merge(const SearchStats& other) {
+        if constexpr (search_stats_enabled) {
+            nodes += other.nodes;
+            for (auto&& [bound, n] : other.iteration_nodes) {
+                iteration_nodes[bound] += n;
+            }
+            estimate_calls += other.estimate_calls;
+            for (unsigned v = 0; v < n_values; ++v) {
+                table_hits[v] += other.table_hits[v];
+            }
+            is_solved_checks += other.is_solved_checks;
+            solutions += other.solutions;
+            first_solution = std::min(first_solution, other.first_solution);
+            all_optimal = std::min(all_optimal, other.all_optimal);
+        }
+    }
+
+    void show(std::ostream& out = std::cout) const {
+        if constexpr (!search_stats_enabled) {
+            out << "Search stats are not compiled in, configure with "
+                   "-DBLOCK_SOLVER_STATS=ON"
+                << std::endl;
+            return;
+        }
+        out << "Nodes: " << nodes << std::endl;
+        for (auto&& [bound, n] : iteration_nodes) {
+            out << "   Iteration " << bound << ": " << n << std::endl;
+        }
+        out << "Estimate calls: " << estimate_calls << std::endl;
+        out << "Table hits by value:";
+        for (unsigned v = 0; v < n_values; ++v) {
+            if (table_hits[v] > 0) out << " " << v << ":" << table_hits[v];
+        }
+        out << std::endl;
+        out << "is_solved checks: " << is_solved_checks << std::endl;
+        out << "Solutions: " << solutions << std::endl;
+    }
+};
+
+// Stats of the searches of the current thread, nullptr when nobody collects
+// them. The steppers call the solvers without options, and the estimators
+// are called from deep inside the search, so the stats are not passed down
+// as an argument.
+inline thread_local SearchStats* collected_stats = nullptr;
+
+struct CollectStats {
+    // Adds the stats of the searches run by this thread to `stats` until it
+    // goes out of scope
+    SearchStats* previous;
+    CollectStats(SearchStats& stats)
+        : previous{std::exchange(collected_stats, &stats)} {}
+    ~CollectStats() { collected_stats = previous; }
+};
+
+inline void count_table_hit(const unsigned value) {
+    // Called by the estimators for every pruning table entry they read
+    if constexpr (search_stats_enabled) {
+        if (collected_stats != nullptr) collected_stats->count_table_hit(value);
+    }
+}
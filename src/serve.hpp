@@ -0,0 +1,402 @@
+#pragma once
+#include <atomic>              // request cancellation
+#include <cerrno>              // errno
+#include <condition_variable>  // wait for the next request
+#include <csignal>             // ignore SIGPIPE
+#include <cstring>             // strerror
+#include <deque>               // pending requests
+#include <exception>           // errors of a request
+#include <functional>          // std::function
+#include <iostream>
+#include <map>     // requests of a connection, by id
+#include <memory>  // std::shared_ptr
+#include <mutex>
+#include <sstream>  // split a request, write a report
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch.hpp"          // Report
+#include "search_budget.hpp"  // SearchBudget
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>   // htonl, htons
+#include <netinet/in.h>  // sockaddr_in
+#include <sys/socket.h>  // socket, bind, listen, accept
+#include <sys/un.h>      // sockaddr_un
+#include <unistd.h>      // read, write, close, unlink
+#define BLOCK_SOLVER_SERVE
+#endif
+
+// Solver daemon (block_solver serve). The process keeps its tables loaded
+// and reads requests from the clients of a Unix domain socket or of a
+// localhost TCP port. The protocol is made of lines whose fields are
+// separated by tabs (shown as spaces here):
+//
+//   solve <id> <step and options> <scramble>
+//   cancel <id>
+//
+// for instance "solve\t1\tF2L-1 -s 1\tR U F". The server answers every line
+// printed by the step as "<id>\t<line>", then "<id>\tdone",
+// "<id>\tcancelled" or "<id>\terror\t<message>" when the request is over.
+// The requests are solved concurrently and the block steps send each
+// solution as soon as it is found, so the lines of several requests can be
+// interleaved.
+
+struct ServeRequest {
+    std::string id;
+    // The step, its options and the scramble, as on the command line
+    std::vector<std::string> args;
+    std::atomic<bool> cancelled = false;
+};
+
+// Solves the arguments of a request, hands the solutions that can be shown
+// early to emit and returns the Report of the rest. Throws for invalid
+// requests.
+using ServeSolver = std::function<Report(const std::vector<std::string>& args,
+                                         const ReportSink& emit)>;
+
+inline std::vector<std::string> split_fields(const std::string& line,
+                                             const char separator) {
+    std::vector<std::string> fields;
+    std::istringstream input(line);
+    std::string field;
+    while (std::getline(input, field, separator)) {
+        if (!field.empty()) fields.push_back(field);
+    }
+    return fields;
+}
+
+inline std::shared_ptr<ServeRequest> parse_solve_request(
+    const std::vector<std::string>& fields) {
+    // fields: "solve", id, step and options, scramble. Returns nullptr when
+    // the request is malformed.
+    if (fields.size() != 4) return nullptr;
+    auto request = std::make_shared<ServeRequest>();
+    request->id = fields[1];
+    request->args = split_fields(fields[2], ' ');
+    if (request->args.empty()) return nullptr;
+    request->args.push_back(fields[3]);
+    return request;
+}
+
+inline std::string report_text(const Report& report) {
+    // What the report writes, for the reply of its request. Each report
+    // writes into its own stream, so the reports of several requests and
+    // whatever else the process prints do not mix.
+    std::ostringstream output;
+    report(output);
+    return output.str();
+}
+
+#ifdef BLOCK_SOLVER_SERVE
+
+class ServeConnection {
+    // One client: its socket and its pending requests. The answers are
+    // written a whole report at a time.
+    int fd;
+    std::string buffer;  // read but not yet split into lines
+    std::mutex write_mutex;
+    std::mutex requests_mutex;
+    std::map<std::string, std::shared_ptr<ServeRequest>> requests;
+
+   public:
+    ServeConnection(const int fd) : fd{fd} {}
+    ~ServeConnection() { close(fd); }
+
+    void hang_up() {
+        // Ends the reads of the connection, and drops the answers that are
+        // still to be written
+        shutdown(fd, SHUT_RDWR);
+    }
+
+    bool read_line(std::string& line) {
+        // Returns false once the client has closed the connection
+        std::size_t end;
+        while ((end = buffer.find('\n')) == std::string::npos) {
+            char chunk[4096];
+            ssize_t n = read(fd, chunk, sizeof(chunk));
+            if (n <= 0) return false;
+            buffer.append(chunk, n);
+        }
+        line = buffer.substr(0, end);
+        buffer.erase(0, end + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        return true;
+    }
+
+    void send(const std::string& id, const std::string& text) {
+        // Every line of text is prefixed by the id of its request
+        std::string message;
+        std::istringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line)) {
+            message += id + "\t" + line + "\n";
+        }
+        std::lock_guard<std::mutex> lock(write_mutex);
+        for (std::size_t sent = 0; sent < message.size();) {
+            ssize_t n = write(fd, message.data() + sent, message.size() - sent);
+            if (n <= 0) return;  // the client is gone, the answer is dropped
+            sent += n;
+        }
+    }
+
+    bool add(const std::shared_ptr<ServeRequest>& request) {
+        // Returns false if a pending request has the same id
+        std::lock_guard<std::mutex> lock(requests_mutex);
+        return requests.emplace(request->id, request).second;
+    }
+
+    void remove(const std::string& id) {
+        std::lock_guard<std::mutex> lock(requests_mutex);
+        requests.erase(id);
+    }
+
+    bool cancel(const std::string& id) {
+        std::lock_guard<std::mutex> lock(requests_mutex);
+        auto found = requests.find(id);
+        if (found == requests.end()) return false;
+        found->second->cancelled = true;
+        return true;
+    }
+
+    void cancel_all() {
+        std::lock_guard<std::mutex> lock(requests_mutex);
+        for (auto&& [id, request] : requests) {
+            request->cancelled = true;
+        }
+    }
+};
+
+class ServePool {
+    // Worker threads solving the requests of all the clients, in the order
+    // they arrive. A request cancelled before it starts is not solved, one
+    // cancelled while it runs stops its searches (see SearchBudget).
+    struct Job {
+        std::shared_ptr<ServeConnection> connection;
+        std::shared_ptr<ServeRequest> request;
+    };
+
+    ServeSolver solve;
+    std::deque<Job> jobs;
+    std::mutex mutex;
+    std::condition_variable job_ready;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void run(const Job& job) {
+        auto& request = *job.request;
+        std::string output, status = "done";
+        if (!request.cancelled) {
+            try {
+                SearchBudget budget;
+                budget.cancel = &request.cancelled;
+                BudgetWith spend(budget);
+                auto emit = [&](const Report& report) {
+                    job.connection->send(request.id, report_text(report));
+                };
+                output = report_text(solve(request.args, emit));
+            } catch (const std::exception& error) {
+                status = std::string("error\t") + error.what();
+            }
+        }
+        if (request.cancelled) status = "cancelled";
+        job.connection->remove(request.id);
+        job.connection->send(request.id, output + status + "\n");
+    }
+
+    void work() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                job_ready.wait(lock,
+                               [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            run(job);
+        }
+    }
+
+   public:
+    ServePool(const ServeSolver& solve, unsigned n_threads) : solve{solve} {
+        if (n_threads < 1) n_threads = 1;
+        for (unsigned t = 0; t < n_threads; ++t) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ServePool() {
+        // Finishes the queued requests first
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        job_ready.notify_all();
+        for (auto&& w : workers) {
+            w.join();
+        }
+    }
+
+    void submit(const std::shared_ptr<ServeConnection>& connection,
+                const std::shared_ptr<ServeRequest>& request) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back({connection, request});
+        }
+        job_ready.notify_one();
+    }
+};
+
+inline void serve_connection(const std::shared_ptr<ServeConnection>& client,
+                             ServePool& pool) {
+    // Reads the requests of a client until it closes the connection, which
+    // cancels its pending requests
+    std::string line;
+    while (client->read_line(line)) {
+        auto fields = split_fields(line, '\t');
+        if (fields.empty()) continue;
+        if (fields[0] == "solve") {
+            auto request = parse_solve_request(fields);
+            if (request == nullptr) {
+                client->send(fields.size() > 1 ? fields[1] : "?",
+                             "error\tmalformed request\n");
+            } else if (!client->add(request)) {
+                client->send(request->id, "error\tid already in use\n");
+            } else {
+                pool.submit(client, request);
+            }
+        } else if (fields[0] == "cancel" && fields.size() == 2) {
+            if (!client->cancel(fields[1])) {
+                client->send(fields[1], "error\tno pending request\n");
+            }
+        } else {
+            client->send("?", "error\tunknown command\n");
+        }
+    }
+    client->cancel_all();
+}
+
+class ServeClients {
+    // The threads reading the clients, one per connection. The threads of
+    // the closed connections are joined when the next client arrives. The
+    // destructor hangs up the connections that are still open and waits for
+    // their threads, so that none of them outlives the pool it submits to.
+    struct Client {
+        std::thread thread;
+        std::weak_ptr<ServeConnection> connection;
+    };
+
+    ServePool& pool;
+    std::mutex mutex;
+    std::map<unsigned long, Client> clients;
+    std::vector<unsigned long> finished;
+    unsigned long next_id = 0;
+
+    static void join(std::vector<std::thread>& threads) {
+        // Without the lock, which the threads take once they are done
+        for (auto&& thread : threads) {
+            thread.join();
+        }
+    }
+
+   public:
+    ServeClients(ServePool& pool) : pool{pool} {}
+
+    ~ServeClients() {
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto&& [id, client] : clients) {
+                if (auto connection = client.connection.lock()) {
+                    connection->hang_up();
+                }
+                threads.push_back(std::move(client.thread));
+            }
+        }
+        join(threads);
+    }
+
+    void start(const std::shared_ptr<ServeConnection>& connection) {
+        std::vector<std::thread> done;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto id : finished) {
+                done.push_back(std::move(clients[id].thread));
+                clients.erase(id);
+            }
+            finished.clear();
+
+            unsigned long id = next_id++;
+            clients[id].connection = connection;
+            // The lock keeps the thread from reporting itself finished
+            // before it is stored
+            clients[id].thread = std::thread([this, connection, id] {
+                serve_connection(connection, pool);
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.push_back(id);
+            });
+        }
+        join(done);
+    }
+};
+
+inline int listen_unix(const char* path) {
+    // Listening socket bound to path, which is replaced if it exists.
+    // Returns -1 on failure.
+    sockaddr_un address{};
+    if (std::strlen(path) >= sizeof(address.sun_path)) return -1;
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    unlink(path);
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline int listen_tcp(const unsigned port) {
+    // Listening socket on the loopback interface only, -1 on failure
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline int serve(const int listen_fd, const ServeSolver& solve,
+                 const unsigned n_threads) {
+    // Serves the clients of the listening socket on n_threads workers until
+    // accept fails. The connections still open are then hung up, and serve
+    // returns once their threads and the pool are done.
+    std::signal(SIGPIPE, SIG_IGN);  // a client may leave before its answers
+    ServePool pool(solve, n_threads);
+    ServeClients clients(pool);
+    while (true) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0 && (errno == EINTR || errno == ECONNABORTED)) continue;
+        if (fd < 0) {
+            std::cerr << "serve: accept failed: " << std::strerror(errno)
+                      << std::endl;
+            return 1;
+        }
+        clients.start(std::make_shared<ServeConnection>(fd));
+    }
+}
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+#include <algorithm>  // std::reverse
+#include <map>        // move names
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "move.hpp"       // Move
+#include "step_node.hpp"  // StepNode
+
+// Writers of the solutions into a given stream, in the format of the show()
+// methods of the solutions and skeletons, which only print on std::cout.
+// The reports of the daemon write into a string per request with them.
+
+inline const char* move_name(const Move move) {
+    static const std::map<Move, const char*> names{
+        {U, "U"}, {U2, "U2"}, {U3, "U'"}, {D, "D"}, {D2, "D2"}, {D3, "D'"},
+        {R, "R"}, {R2, "R2"}, {R3, "R'"}, {L, "L"}, {L2, "L2"}, {L3, "L'"},
+        {F, "F"}, {F2, "F2"}, {F3, "F'"}, {B, "B"}, {B2, "B2"}, {B3, "B'"}};
+    return names.at(move);
+}
+
+inline void write_moves(std::ostream& out, const std::vector<Move>& moves,
+                        const bool inverse) {
+    // "R U F", or "(R U F)" for a solution of the inverse scramble
+    if (inverse) out << "(";
+    for (unsigned k = 0; k < moves.size(); ++k) {
+        out << (k > 0 ? " " : "") << move_name(moves[k]);
+    }
+    if (inverse) out << ")";
+}
+
+inline void write_solution(std::ostream& out, const std::vector<Move>& moves,
+                           const bool inverse = false) {
+    // "R U F (3)", as Solutions::show
+    write_moves(out, moves, inverse);
+    out << " (" << moves.size() << ")" << std::endl;
+}
+
+template <typename NodePtr>
+std::vector<Move> solution_path(NodePtr node) {
+    // The moves from the root of the search to node
+    std::vector<Move> path;
+    for (; node->parent != nullptr; node = node->parent) {
+        path.push_back(node->last_move);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+template <typename Solutions>
+void write_solutions(std::ostream& out, const Solutions& solutions,
+                     const bool inverse = false) {
+    for (auto&& node : solutions) {
+        write_solution(out, solution_path(node), inverse);
+    }
+}
+
+inline void write_skeleton(std::ostream& out, const StepNode::sptr& node,
+                           const std::vector<std::string>& names) {
+    // One line per step, "R U F // 2x2x2 (3/3)", as Skeleton::show
+    std::vector<StepNode::sptr> steps;
+    for (auto step = node; step->parent != nullptr; step = step->parent) {
+        steps.push_back(step);
+    }
+    std::reverse(steps.begin(), steps.end());
+    for (unsigned k = 0; k < steps.size(); ++k) {
+        auto& step = steps[k];
+        write_moves(out, step->seq.sequence, step->is_inverse);
+        out << " // " << (k < names.size() ? names[k] : "?") << " ("
+            << step->seq.size() << "/" << step->depth << ")" << std::endl;
+    }
+}
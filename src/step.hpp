@@ -1,168 +1,430 @@
 #pragma once
 #include <tuple>  // tables stored as tuples in Mover and Pruner
 
-#include "coordinate_block_cube.hpp"  // MultiBlockCube
-#include "move_table.hpp"             // BlockMoveTable
-#include "pruning_table.hpp"          // load_ptr(Strategy)
-#include "search.hpp"                 // DFS and IDA*
-
-template <unsigned nc, unsigned ne>
-auto load_pruning_table(Block<nc, ne>& b) {
-    // Load the pruning table for the given block
+#include "ida_search.hpp"            // parallel IDA*
+#include "lazy_table.hpp"            // tables loaded by the first search
+#include "mapped_pruning_table.hpp"  // NibbleTable, Mod3Table
+#include "move_table.hpp"            // BlockMoveTable
+#include "pruning_table.hpp"         // load_ptr(Strategy)
+#include "search.hpp"                // DFS and IDA*
+#include "sym_block_cube.hpp"        // SymBlockCube, SymMoveTable
+#include "sym_pruning_table.hpp"     // SymPruningTable
+#include "table_generation.hpp"      // generate_depths
+
+template <typename Table = NibbleTable, unsigned nc, unsigned ne>
+auto generate_pruning_table(const Block<nc, ne>& b) {
+    // Generates the pruning table of the block in memory
     constexpr size_t table_size = b.n_es * b.n_cs;
-    PruningTable<table_size> ptable;
-    bool check = ptable.load(b.id);
-    if (!check) {
+    BlockMoveTable<nc, ne> mtable(b);
+    auto root = b.to_coordinate_block_cube(CubieCube());
+    auto generated = generate_depths(table_size, root, mtable.get_apply(),
+                                     b.get_indexer(), b.get_from_index());
+    Table ptable(table_size);
+    ptable.assign(generated);
+    return ptable;
+}
+
+template <typename Table = NibbleTable, unsigned nc, unsigned ne>
+auto load_pruning_table(const Block<nc, ne>& b) {
+    // Load the pruning table for the given block, generating it on first use
+    constexpr size_t table_size = b.n_es * b.n_cs;
+    Table ptable(table_size);
+    if (!ptable.load(b.id)) {
         print("Generating pruning table", b.id);
-        BlockMoveTable<nc, ne> mtable(b);
-        auto root = b.to_coordinate_block_cube(CubieCube());
-        ptable.template generate<true>(root, mtable.get_apply(),
-                                       b.get_indexer(), b.get_from_index(),
-                                       HTM_Moves);
+        ptable = generate_pruning_table<Table>(b);
+        ptable.write(b.id);
+        ptable.load(b.id);
     }
-    ptable.write(b.id);
     return ptable;
 };
 
+template <typename Table = NibbleTable, unsigned nc, unsigned ne>
+auto load_sym_pruning_table(const Block<nc, ne>& b,
+                            const BlockMoveTable<nc, ne>& m_table) {
+    // Same as load_pruning_table, with the table reduced by the symmetries
+    // of the block
+    SymPruningTable<nc, ne, Table> ptable(b, m_table);
+    if (!ptable.load(b)) {
+        print("Generating pruning table", ptable.table_id(b));
+        ptable.generate(b, m_table);
+        ptable.write(b);
+        ptable.load(b);
+    }
+    return ptable;
+}
+
+template <typename Table = NibbleTable, unsigned nc, unsigned ne>
+auto load_block_pruning_table(const Block<nc, ne>& b,
+                              const BlockMoveTable<nc, ne>& m_table) {
+    // The table the solvers use, reduced by the symmetries of the block when
+    // the project is configured with -DBLOCK_SOLVER_SYM_TABLES=ON
+    if constexpr (use_sym_tables) {
+        return load_sym_pruning_table<Table>(b, m_table);
+    } else {
+        return load_pruning_table<Table>(b);
+    }
+}
+
 template <std::size_t NS, typename MoveTable>
 auto get_sym_apply(const MoveTable& m_table,
                    const std::array<unsigned, NS>& rotations) {
-    return [&m_table, &rotations](const Move& move, MultiBlockCube<NS>& cube) {
-        for (unsigned k = 0; k < NS; ++k) {
-            m_table.sym_apply(move, rotations[k], cube[k]);
-        }
-    };
+    // Moves all the symmetries at once, see SymMoveTable
+    return SymMoveTable<MoveTable, NS>(m_table, rotations);
 }
 
 template <std::size_t NS, typename Block>
-auto get_is_solved(Block& block) {
-    return [&block](const MultiBlockCube<NS>& cube) {
+auto get_is_solved(const Block& block) {
+    return [block](const SymBlockCube<NS>& cube) {
         // Returns true if at least one of the symmetries is solved
-        for (auto cbc : cube) {
-            if (block.is_solved(cbc)) return true;
+        for (unsigned k = 0; k < NS; ++k) {
+            if (block.is_solved(cube[k])) return true;
         }
         return false;
     };
 }
 
-template <std::size_t NB, typename PruningTable, typename Indexer>
-auto get_estimator(const PruningTable& p_table, const Indexer& index) {
-    return [&p_table, &index](const MultiBlockCube<NB>& cube) {
-        // Return the minimum estimate over all the cbcs
-        unsigned ret = p_table.estimate(index(cube[0]));
-        for (auto cbc : cube) {
-            auto e = p_table.estimate(index(cbc));
+template <std::size_t NS, typename PruningTable, typename Block>
+struct SymEstimator {
+    // Pruning value of a SymBlockCube: the minimum over the symmetries. The
+    // entries of all the symmetries are prefetched before the first one is
+    // read, so that the random accesses to the table overlap. The search
+    // keeps the indices of each child from prefetch to within.
+    using Lookup = std::array<unsigned, NS>;
+    const PruningTable& p_table;
+    const Block& block;
+
+    void look_up(const SymBlockCube<NS>& cube, Lookup& indices) const {
+        sym_block_indices(block, cube, indices);
+    }
+
+    void prefetch(const Lookup& indices) const {
+        for (unsigned k = 0; k < NS; ++k) {
+            p_table.prefetch(indices[k]);
+        }
+    }
+
+    unsigned operator()(const SymBlockCube<NS>& cube) const {
+        Lookup indices;
+        look_up(cube, indices);
+        prefetch(indices);
+        unsigned ret = p_table.estimate(indices[0]);
+        for (unsigned k = 1; k < NS; ++k) {
+            unsigned e = p_table.estimate(indices[k]);
             ret = (e < ret) ? e : ret;
         }
         return ret;
-    };
+    }
+
+    bool within(const Lookup& indices, const unsigned budget) const {
+        // Stops at the first symmetry within the budget
+        for (unsigned k = 0; k < NS; ++k) {
+            if (p_table.estimate(indices[k]) <= budget) return true;
+        }
+        return false;
+    }
+
+    bool within(const SymBlockCube<NS>& cube, const unsigned budget) const {
+        Lookup indices;
+        look_up(cube, indices);
+        prefetch(indices);
+        return within(indices, budget);
+    }
+};
+
+template <std::size_t NS, typename PruningTable, typename Block>
+auto get_estimator(const PruningTable& p_table, const Block& block) {
+    return SymEstimator<NS, PruningTable, Block>{p_table, block};
 }
 
-template <typename Block, long unsigned NS>
-auto init_root(const CubieCube& scramble_cc, Block& block,
-               const std::array<unsigned, NS>& rotations) {
-    MultiBlockCube<NS> ret;
+template <std::size_t NS, typename PruningTable1, typename Block1,
+          typename PruningTable2, typename Block2>
+struct SplitSymEstimator {
+    // Pruning value of a block split in two subblocks: the maximum of the two
+    // subblock values, minimized over the symmetries
+    using Cube = std::array<SymBlockCube<NS>, 2>;
+    using Lookup = std::array<std::array<unsigned, NS>, 2>;
+    const PruningTable1& p_table1;
+    const Block1& block1;
+    const PruningTable2& p_table2;
+    const Block2& block2;
 
-    for (unsigned k = 0; k < NS; ++k) {
-        ret[k] = block.to_coordinate_block_cube(
-            scramble_cc.get_conjugate(rotations[k]));
+    void look_up(const Cube& cube, Lookup& indices) const {
+        sym_block_indices(block1, cube[0], indices[0]);
+        sym_block_indices(block2, cube[1], indices[1]);
     }
-    return make_root(ret);
+
+    void prefetch(const Lookup& indices) const {
+        for (unsigned k = 0; k < NS; ++k) {
+            p_table1.prefetch(indices[0][k]);
+            p_table2.prefetch(indices[1][k]);
+        }
+    }
+
+    unsigned operator()(const Cube& cube) const {
+        Lookup indices;
+        look_up(cube, indices);
+        prefetch(indices);
+        unsigned ret = 0;
+        for (unsigned k = 0; k < NS; ++k) {
+            unsigned e1 = p_table1.estimate(indices[0][k]);
+            unsigned e2 = p_table2.estimate(indices[1][k]);
+            unsigned e = e1 > e2 ? e1 : e2;
+            ret = (k == 0 || e < ret) ? e : ret;
+        }
+        return ret;
+    }
+
+    bool within(const Lookup& indices, const unsigned budget) const {
+        // Stops at the first symmetry within the budget
+        for (unsigned k = 0; k < NS; ++k) {
+            if (p_table1.estimate(indices[0][k]) <= budget &&
+                p_table2.estimate(indices[1][k]) <= budget) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool within(const Cube& cube, const unsigned budget) const {
+        Lookup indices;
+        look_up(cube, indices);
+        prefetch(indices);
+        return within(indices, budget);
+    }
+};
+
+template <std::size_t NS, typename PruningTable1, typename Block1,
+          typename PruningTable2, typename Block2>
+auto get_split_estimator(const PruningTable1& p_table1, const Block1& block1,
+                         const PruningTable2& p_table2, const Block2& block2) {
+    return SplitSymEstimator<NS, PruningTable1, Block1, PruningTable2, Block2>{
+        p_table1, block1, p_table2, block2};
 }
 
 template <typename Block, long unsigned NS>
-auto make_root_initializer(Block& block,
+auto init_root(const CubieCube& scramble_cc, const Block& block,
+               const std::array<unsigned, NS>& rotations) {
+    return make_root(make_sym_block_cube(block, scramble_cc, rotations));
+}
+
+template <typename Block, long unsigned NS>
+auto make_root_initializer(const Block& block,
                            const std::array<unsigned, NS>& rotations) {
-    return [&block, &rotations](const Algorithm& scramble) {
+    return [block, rotations](const Algorithm& scramble) {
         CubieCube scramble_cc(scramble);
         return init_root(scramble_cc, block, rotations);
     };
 }
 template <typename Block, long unsigned NS>
-auto make_root_cc_initializer(Block& block,
+auto make_root_cc_initializer(const Block& block,
                               const std::array<unsigned, NS>& rotations) {
-    return [&block, &rotations](const CubieCube& scramble_cc) {
+    return [block, rotations](const CubieCube& scramble_cc) {
         return init_root(scramble_cc, block, rotations);
     };
 }
 
 template <unsigned nc, unsigned ne, long unsigned NS>
-auto make_optimal_block_solver(Block<nc, ne>& block,
+auto make_optimal_block_solver(const Block<nc, ne>& block,
                                const std::array<unsigned, NS>& rotations) {
-    static auto m_table = BlockMoveTable(block);
-    static auto p_table = load_pruning_table(block);
-    static auto apply = get_sym_apply<NS>(m_table, rotations);
-    static auto estimate = get_estimator<NS>(p_table, block.get_indexer());
+    // The tables are loaded by the first search rather than when the solver
+    // is made, so that only the steps that are run load theirs. The loaders
+    // keep copies of the block and the rotations, which they outlive.
+    static LazyTable m_table([block] { return BlockMoveTable(block); });
+    static LazyTable p_table(
+        [block] { return load_block_pruning_table(block, m_table.get()); });
+    static LazyTable apply(
+        [rotations] { return get_sym_apply<NS>(m_table.get(), rotations); });
+    static LazyTable estimate(
+        [block] { return get_estimator<NS>(p_table.get(), block); });
     static auto is_solved = get_is_solved<NS>(block);
 
     return [](const auto root, const unsigned max_depth = 20,
-              const unsigned slackness = 0) {
-        return IDAstar<false>(root, apply, estimate, is_solved, max_depth,
-                              slackness);
+              const unsigned slackness = 0,
+              const SearchOptions& options = {}) {
+        return ida_search(root, apply.get(), estimate.get(), is_solved,
+                          max_depth, slackness, options);
     };
 }
 
 template <typename Block1, typename Block2, long unsigned NS>
-auto make_split_block_root(const CubieCube& scramble_cc, Block1& block1,
-                           Block2& block2,
+auto make_split_block_root(const CubieCube& scramble_cc, const Block1& block1,
+                           const Block2& block2,
                            const std::array<unsigned, NS>& rotations) {
-    using Cube = std::array<MultiBlockCube<2>, NS>;
-    Cube ret;
-
-    for (unsigned k = 0; k < NS; ++k) {
-        ret[k][0] = block1.to_coordinate_block_cube(
-            scramble_cc.get_conjugate(rotations[k]));
-        ret[k][1] = block2.to_coordinate_block_cube(
-            scramble_cc.get_conjugate(rotations[k]));
-    }
+    using Cube = std::array<SymBlockCube<NS>, 2>;
+    Cube ret{make_sym_block_cube(block1, scramble_cc, rotations),
+             make_sym_block_cube(block2, scramble_cc, rotations)};
 
     return make_root(ret);
 }
 
 template <typename Block1, typename Block2, long unsigned NS>
 auto make_optimal_split_block_solver(
-    Block1& block1, Block2& block2, const std::array<unsigned, NS>& rotations) {
-    using Cube = std::array<MultiBlockCube<2>, NS>;
+    const Block1& block1, const Block2& block2,
+    const std::array<unsigned, NS>& rotations) {
+    using Cube = std::array<SymBlockCube<NS>, 2>;
+
+    // Loaded by the first search, see make_optimal_block_solver
+    static LazyTable m_table1([block1] { return BlockMoveTable(block1); });
+    static LazyTable m_table2([block2] { return BlockMoveTable(block2); });
+    static LazyTable p_table1([block1] {
+        return load_block_pruning_table(block1, m_table1.get());
+    });
+    static LazyTable p_table2([block2] {
+        return load_block_pruning_table(block2, m_table2.get());
+    });
+
+    // Bound to the loaded tables, so that moving a node does not check
+    // whether they are loaded
+    static LazyTable apply([rotations] {
+        return [sym_apply1 = get_sym_apply<NS>(m_table1.get(), rotations),
+                sym_apply2 = get_sym_apply<NS>(m_table2.get(), rotations)](
+                   const Move& move, Cube& cube) {
+            sym_apply1(move, cube[0]);
+            sym_apply2(move, cube[1]);
+        };
+    });
 
-    static auto m_table1 = BlockMoveTable(block1);
-    static auto m_table2 = BlockMoveTable(block2);
-    static auto p_table1 = load_pruning_table(block1);
-    static auto p_table2 = load_pruning_table(block2);
+    static LazyTable estimate([block1, block2] {
+        return get_split_estimator<NS>(p_table1.get(), block1, p_table2.get(),
+                                       block2);
+    });
 
-    static auto apply = [&rotations](const Move& move, Cube& cube) {
+    static auto is_solved = [block1, block2](const Cube& cube) {
         for (unsigned k = 0; k < NS; ++k) {
-            m_table1.sym_apply(move, rotations[k], cube[k][0]);
-            m_table2.sym_apply(move, rotations[k], cube[k][1]);
+            if (block1.is_solved(cube[0][k]) && block2.is_solved(cube[1][k]))
+                return true;
         }
+        return false;
+    };
+
+    return [](const auto root, const unsigned max_depth = 20,
+              const unsigned slackness = 0,
+              const SearchOptions& options = {}) {
+        return ida_search(root, apply.get(), estimate.get(), is_solved,
+                          max_depth, slackness, options);
     };
+}
+template <std::size_t NS>
+struct SplitDepthCube {
+    // A split block cube searched with mod 3 pruning tables: the depths of
+    // the symmetries of both subblocks are carried along with the cube, since
+    // the tables only give them relative to the depths of the parent
+    std::array<SymBlockCube<NS>, 2> blocks;
+    std::array<std::array<uint8_t, NS>, 2> depths;
+};
 
-    static auto max_estimate = [block1,
-                                block2](const MultiBlockCube<2>& subcube) {
-        auto e1 = p_table1.estimate(block1.index(subcube[0]));
-        auto e2 = p_table2.estimate(block2.index(subcube[1]));
-        return e1 > e2 ? e1 : e2;
+template <std::size_t NS, typename PruningTable, typename MoveTable,
+          typename Block>
+void sym_root_depths(const PruningTable& p_table, const MoveTable& m_table,
+                     const Block& block, const SymBlockCube<NS>& cube,
+                     std::array<uint8_t, NS>& depths) {
+    auto apply = [&m_table](const Move& move, PackedBlockCube& packed) {
+        m_table.apply(move, packed);
+    };
+    auto index = [&block](const PackedBlockCube& packed) {
+        return block.index(packed);
+    };
+    auto is_solved = [&block](const PackedBlockCube& packed) {
+        return block.is_solved(packed);
     };
+    for (unsigned k = 0; k < NS; ++k) {
+        depths[k] = p_table.root_depth(cube[k], apply, index, is_solved);
+    }
+}
 
-    static auto estimate = [](const Cube& cube) {
-        unsigned ret = max_estimate(cube[0]);
+template <std::size_t NS, typename PruningTable, typename Block>
+void update_sym_depths(const PruningTable& p_table, const Block& block,
+                       const SymBlockCube<NS>& cube,
+                       std::array<uint8_t, NS>& depths) {
+    // Replaces the depths of the parent by the depths of the moved cube
+    std::array<unsigned, NS> indices;
+    sym_block_indices(block, cube, indices);
+    for (unsigned k = 0; k < NS; ++k) {
+        p_table.prefetch(indices[k]);
+    }
+    for (unsigned k = 0; k < NS; ++k) {
+        depths[k] = p_table.depth(indices[k], depths[k]);
+    }
+}
+
+template <std::size_t NS>
+struct SplitDepthEstimator {
+    // Same value as SplitSymEstimator, from the depths stored in the cube
+    unsigned operator()(const SplitDepthCube<NS>& cube) const {
+        unsigned ret = 0;
         for (unsigned k = 0; k < NS; ++k) {
-            unsigned e = max_estimate(cube[k]);
-            ret = ret < e ? ret : e;
+            unsigned e1 = cube.depths[0][k], e2 = cube.depths[1][k];
+            unsigned e = e1 > e2 ? e1 : e2;
+            ret = (k == 0 || e < ret) ? e : ret;
         }
         return ret;
-    };
+    }
 
-    static auto is_solved = [&block1, &block2](const Cube& cube) {
+    bool within(const SplitDepthCube<NS>& cube, const unsigned budget) const {
         for (unsigned k = 0; k < NS; ++k) {
-            if (block1.is_solved(cube[k][0]) && block2.is_solved(cube[k][1]))
+            if (cube.depths[0][k] <= budget && cube.depths[1][k] <= budget) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+template <typename Block1, typename Block2, long unsigned NS>
+auto make_mod3_split_block_solver(const Block1& block1, const Block2& block2,
+                                  const std::array<unsigned, NS>& rotations) {
+    // make_optimal_split_block_solver with Mod3Table: the tables take
+    // half the memory, the depths are rebuilt move after move. The solver
+    // takes the same roots, the solutions are nodes of SplitDepthCube.
+    using Cube = SplitDepthCube<NS>;
+
+    static LazyTable m_table1([block1] { return BlockMoveTable(block1); });
+    static LazyTable m_table2([block2] { return BlockMoveTable(block2); });
+    static LazyTable p_table1([block1] {
+        return load_block_pruning_table<Mod3Table>(block1, m_table1.get());
+    });
+    static LazyTable p_table2([block2] {
+        return load_block_pruning_table<Mod3Table>(block2, m_table2.get());
+    });
+
+    static LazyTable apply([block1, block2, rotations] {
+        return [block1, block2, &p_table1 = p_table1.get(),
+                &p_table2 = p_table2.get(),
+                sym_apply1 = get_sym_apply<NS>(m_table1.get(), rotations),
+                sym_apply2 = get_sym_apply<NS>(m_table2.get(), rotations)](
+                   const Move& move, Cube& cube) {
+            sym_apply1(move, cube.blocks[0]);
+            sym_apply2(move, cube.blocks[1]);
+            update_sym_depths(p_table1, block1, cube.blocks[0],
+                              cube.depths[0]);
+            update_sym_depths(p_table2, block2, cube.blocks[1],
+                              cube.depths[1]);
+        };
+    });
+
+    static auto is_solved = [block1, block2](const Cube& cube) {
+        for (unsigned k = 0; k < NS; ++k) {
+            if (block1.is_solved(cube.blocks[0][k]) &&
+                block2.is_solved(cube.blocks[1][k]))
                 return true;
         }
         return false;
     };
 
+    static auto make_depth_root = [block1, block2](const auto& blocks) {
+        Cube cube{blocks, {}};
+        sym_root_depths(p_table1.get(), m_table1.get(), block1, blocks[0],
+                        cube.depths[0]);
+        sym_root_depths(p_table2.get(), m_table2.get(), block2, blocks[1],
+                        cube.depths[1]);
+        return make_root(cube);
+    };
+
     return [](const auto root, const unsigned max_depth = 20,
-              const unsigned slackness = 0) {
-        return IDAstar<false>(root, apply, estimate, is_solved, max_depth,
-                              slackness);
+              const unsigned slackness = 0,
+              const SearchOptions& options = {}) {
+        return ida_search(make_depth_root(root->state), apply.get(),
+                          SplitDepthEstimator<NS>{}, is_solved, max_depth,
+                          slackness, options);
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,244 @@
+#pragma once
+#include <array>
+#include <cstdint>  // uint32_t lanes
+#include <iostream>
+
+#include "coordinate_block_cube.hpp"  // PackedBlockCube
+#include "move_table.hpp"             // BlockMoveTable
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>  // gathers
+#define BLOCK_SOLVER_X86_SIMD
+#endif
+
+enum class SimdLevel { scalar, avx2, avx512 };
+
+SimdLevel detect_simd_level() {
+#ifdef BLOCK_SOLVER_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::avx512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::avx2;
+#endif
+    return SimdLevel::scalar;
+}
+
+// Kernel used by SymMoveTable: the widest one the CPU supports by default,
+// it can be lowered at runtime (block_solver --scalar)
+SimdLevel simd_level = detect_simd_level();
+
+template <std::size_t NS>
+struct SymBlockCube {
+    // One block seen from NS symmetries, stored as a struct of arrays: each
+    // packed coordinate of the NS copies is contiguous, so that a move can be
+    // applied to all the copies with SIMD gathers. The arrays are padded to
+    // whole AVX-512 registers, the padding lanes are never read back.
+    static constexpr std::size_t n_lanes = (NS + 15) / 16 * 16;
+    alignas(64) std::array<uint32_t, n_lanes> ccl, cel, cclp, celp, cco, ceo;
+
+    SymBlockCube() {
+        for (auto coord : {&ccl, &cel, &cclp, &celp, &cco, &ceo}) {
+            coord->fill(0);
+        }
+    }
+
+    PackedBlockCube operator[](const std::size_t k) const {
+        return PackedBlockCube(ccl[k], cel[k], cclp[k], celp[k], cco[k],
+                               ceo[k]);
+    }
+
+    void set(const std::size_t k, const PackedBlockCube& cube) {
+        ccl[k] = cube.ccl;
+        cel[k] = cube.cel;
+        cclp[k] = cube.cclp;
+        celp[k] = cube.celp;
+        cco[k] = cube.cco;
+        ceo[k] = cube.ceo;
+    }
+
+    void show() const {
+        std::cout << "SymBlockCube<" << NS << ">" << std::endl;
+        for (unsigned k = 0; k < NS; ++k) {
+            std::cout << "   Symmetry " << k << ": ";
+            (*this)[k].show();
+        }
+    }
+};
+
+template <typename Block, std::size_t NS>
+SymBlockCube<NS> make_sym_block_cube(
+    const Block& block, const CubieCube& cc,
+    const std::array<unsigned, NS>& rotations) {
+    SymBlockCube<NS> cube;
+    for (unsigned k = 0; k < NS; ++k) {
+        auto conj = cc.get_conjugate(rotations[k]);
+        cube.set(k, block.to_packed_block_cube(conj));
+    }
+    return cube;
+}
+
+template <typename Block, std::size_t NS>
+void sym_block_indices(const Block& block, const SymBlockCube<NS>& cube,
+                       std::array<unsigned, NS>& indices) {
+    // Block::index of every copy, as a loop over the lanes that the compiler
+    // can vectorize
+    constexpr unsigned n_co = Block::n_co, n_eo = Block::n_eo;
+    constexpr unsigned n_cs = Block::n_cs;
+    for (unsigned k = 0; k < NS; ++k) {
+        indices[k] = (cube.celp[k] * n_eo + cube.ceo[k]) * n_cs +
+                     (cube.cclp[k] * n_co + cube.cco[k]);
+    }
+}
+
+template <typename MoveTable, std::size_t NS>
+struct SymMoveTable {
+    // Applies a move to the NS copies of a SymBlockCube in one pass. Copy k is
+    // seen through the symmetry rotations[k], so it is moved by the conjugated
+    // move, which is precomputed for every move and lane.
+    using Cube = SymBlockCube<NS>;
+    static constexpr std::size_t n_lanes = Cube::n_lanes;
+    static constexpr bool has_corners = MoveTable::n_corners > 0;
+    static constexpr bool has_edges = MoveTable::n_edges > 0;
+
+    const MoveTable& table;
+    alignas(64) std::array<std::array<uint32_t, n_lanes>, N_HTM_MOVES>
+        conj_moves{};
+
+    SymMoveTable(const MoveTable& table,
+                 const std::array<unsigned, NS>& rotations)
+        : table{table} {
+        for (Move move : HTM_Moves) {
+            for (unsigned k = 0; k < NS; ++k) {
+                conj_moves[move][k] = move_conj(move, rotations[k]);
+            }
+        }
+    }
+
+    void apply(const Move& move, Cube& cube) const {
+#ifdef BLOCK_SOLVER_X86_SIMD
+        if (simd_level == SimdLevel::avx512) return apply_avx512(move, cube);
+        if (simd_level >= SimdLevel::avx2) return apply_avx2(move, cube);
+#endif
+        apply_scalar(move, cube);
+    }
+
+    void operator()(const Move& move, Cube& cube) const { apply(move, cube); }
+
+    void apply_scalar(const Move& move, Cube& cube) const {
+        // Same lookups as BlockMoveTable::apply on a PackedBlockCube
+        constexpr unsigned n_co = MoveTable::n_co, n_eo = MoveTable::n_eo;
+        for (unsigned k = 0; k < NS; ++k) {
+            const unsigned m = conj_moves[move][k];
+            if constexpr (has_corners) {
+                unsigned co_row = cube.ccl[k] * n_co + cube.cco[k];
+                cube.cco[k] = table.co_table[N_HTM_MOVES * co_row + m];
+                cube.cclp[k] = table.cp_table[N_HTM_MOVES * cube.cclp[k] + m];
+                cube.ccl[k] = table.cl_table[N_HTM_MOVES * cube.ccl[k] + m];
+            }
+            if constexpr (has_edges) {
+                unsigned eo_row = cube.cel[k] * n_eo + cube.ceo[k];
+                cube.ceo[k] = table.eo_table[N_HTM_MOVES * eo_row + m];
+                cube.celp[k] = table.ep_table[N_HTM_MOVES * cube.celp[k] + m];
+                cube.cel[k] = table.el_table[N_HTM_MOVES * cube.cel[k] + m];
+            }
+        }
+    }
+
+#ifdef BLOCK_SOLVER_X86_SIMD
+    // The gathers load 32 bits at the address of each entry and only keep the
+    // bytes of the entry. The tables are padded for the bytes read past the
+    // end of the last entry.
+    template <typename T>
+    __attribute__((target("avx2"))) static __m256i gather(const T* entries,
+                                                          __m256i row,
+                                                          __m256i m) {
+        __m256i index = _mm256_add_epi32(
+            _mm256_mullo_epi32(row, _mm256_set1_epi32(N_HTM_MOVES)), m);
+        __m256i v = _mm256_i32gather_epi32(
+            reinterpret_cast<const int*>(entries), index, sizeof(T));
+        if constexpr (sizeof(T) < 4) {
+            const int mask = (1 << 8 * sizeof(T)) - 1;
+            v = _mm256_and_si256(v, _mm256_set1_epi32(mask));
+        }
+        return v;
+    }
+
+    template <typename T>
+    __attribute__((target("avx512f"))) static __m512i gather(const T* entries,
+                                                             __m512i row,
+                                                             __m512i m) {
+        __m512i index = _mm512_add_epi32(
+            _mm512_mullo_epi32(row, _mm512_set1_epi32(N_HTM_MOVES)), m);
+        __m512i v = _mm512_i32gather_epi32(
+            index, reinterpret_cast<const int*>(entries), sizeof(T));
+        if constexpr (sizeof(T) < 4) {
+            const int mask = (1 << 8 * sizeof(T)) - 1;
+            v = _mm512_and_si512(v, _mm512_set1_epi32(mask));
+        }
+        return v;
+    }
+
+    __attribute__((target("avx2"))) void apply_avx2(const Move& move,
+                                                    Cube& cube) const {
+#define LOAD(p) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))
+#define STORE(p, v) _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v)
+        for (unsigned k = 0; k < NS; k += 8) {
+            const __m256i m = LOAD(&conj_moves[move][k]);
+            if constexpr (has_corners) {
+                __m256i ccl = LOAD(&cube.ccl[k]);
+                __m256i co_row = _mm256_add_epi32(
+                    _mm256_mullo_epi32(ccl, _mm256_set1_epi32(MoveTable::n_co)),
+                    LOAD(&cube.cco[k]));
+                STORE(&cube.cco[k], gather(table.co_table.get(), co_row, m));
+                STORE(&cube.cclp[k],
+                      gather(table.cp_table.get(), LOAD(&cube.cclp[k]), m));
+                STORE(&cube.ccl[k], gather(table.cl_table.get(), ccl, m));
+            }
+            if constexpr (has_edges) {
+                __m256i cel = LOAD(&cube.cel[k]);
+                __m256i eo_row = _mm256_add_epi32(
+                    _mm256_mullo_epi32(cel, _mm256_set1_epi32(MoveTable::n_eo)),
+                    LOAD(&cube.ceo[k]));
+                STORE(&cube.ceo[k], gather(table.eo_table.get(), eo_row, m));
+                STORE(&cube.celp[k],
+                      gather(table.ep_table.get(), LOAD(&cube.celp[k]), m));
+                STORE(&cube.cel[k], gather(table.el_table.get(), cel, m));
+            }
+        }
+#undef LOAD
+#undef STORE
+    }
+
+    __attribute__((target("avx512f"))) void apply_avx512(const Move& move,
+                                                         Cube& cube) const {
+        // Runs over the padding lanes too: their move and coordinates are 0,
+        // which the tables map to valid entries
+#define LOAD(p) _mm512_loadu_si512(p)
+#define STORE(p, v) _mm512_storeu_si512(p, v)
+        for (unsigned k = 0; k < n_lanes; k += 16) {
+            const __m512i m = LOAD(&conj_moves[move][k]);
+            if constexpr (has_corners) {
+                __m512i ccl = LOAD(&cube.ccl[k]);
+                __m512i co_row = _mm512_add_epi32(
+                    _mm512_mullo_epi32(ccl, _mm512_set1_epi32(MoveTable::n_co)),
+                    LOAD(&cube.cco[k]));
+                STORE(&cube.cco[k], gather(table.co_table.get(), co_row, m));
+                STORE(&cube.cclp[k],
+                      gather(table.cp_table.get(), LOAD(&cube.cclp[k]), m));
+                STORE(&cube.ccl[k], gather(table.cl_table.get(), ccl, m));
+            }
+            if constexpr (has_edges) {
+                __m512i cel = LOAD(&cube.cel[k]);
+                __m512i eo_row = _mm512_add_epi32(
+                    _mm512_mullo_epi32(cel, _mm512_set1_epi32(MoveTable::n_eo)),
+                    LOAD(&cube.ceo[k]));
+                STORE(&cube.ceo[k], gather(table.eo_table.get(), eo_row, m));
+                STORE(&cube.celp[k],
+                      gather(table.ep_table.get(), LOAD(&cube.celp[k]), m));
+                STORE(&cube.cel[k], gather(table.el_table.get(), cel, m));
+            }
+        }
+#undef LOAD
+#undef STORE
+    }
+#endif
+};
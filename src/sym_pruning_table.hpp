@@ -0,0 +1,218 @@
+#pragma once
+#include <algorithm>  // std::fill
+#include <cassert>
+#include <cstdint>  // uint32_t, uint64_t
+#include <deque>    // breadth first search of the symmetries
+#include <string>
+#include <utility>  // std::pair
+#include <vector>
+
+#include "block.hpp"
+#include "mapped_pruning_table.hpp"  // NibbleTable, Mod3Table
+#include "move_table.hpp"            // BlockMoveTable
+#include "table_generation.hpp"      // GeneratedDepths, generate_layers
+
+// The block solvers use tables reduced by the symmetries of the blocks when
+// the project is configured with -DBLOCK_SOLVER_SYM_TABLES=ON
+#ifdef BLOCK_SOLVER_SYM_TABLES
+constexpr bool use_sym_tables = true;
+#else
+constexpr bool use_sym_tables = false;
+#endif
+
+template <typename MoveTable, typename Coordinate>
+bool coordinate_symmetry(const MoveTable& m_table,
+                         const PackedBlockCube& solved, const unsigned sym,
+                         const Coordinate& coordinate,
+                         std::vector<uint32_t>& image) {
+    // Image of every value of a block coordinate under the symmetry, found by
+    // moving a state and its image together from solved, with a move and its
+    // conjugate. Returns false when a value is reached with two different
+    // images: then the symmetry does not map the block onto itself.
+    constexpr uint32_t unset = UINT32_MAX;
+    std::fill(image.begin(), image.end(), unset);
+    image[coordinate(solved)] = coordinate(solved);
+    std::deque<std::pair<PackedBlockCube, PackedBlockCube>> queue{
+        {solved, solved}};
+    while (!queue.empty()) {
+        auto [cube, conj] = queue.front();
+        queue.pop_front();
+        for (Move move : HTM_Moves) {
+            PackedBlockCube next = cube, next_conj = conj;
+            m_table.apply(move, next);
+            m_table.apply(move_conj(move, sym), next_conj);
+            uint32_t& value = image[coordinate(next)];
+            if (value == unset) {
+                value = coordinate(next_conj);
+                queue.push_back({next, next_conj});
+            } else if (value != coordinate(next_conj)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <unsigned nc, unsigned ne, typename Table = NibbleTable>
+struct SymPruningTable {
+    // Pruning table of a block indexed by symmetry class. The symmetries that
+    // map the block onto itself (its stabilizer) do not change the distance
+    // to solved, so the edge coordinate is replaced by the class of its
+    // images and the corner coordinate by its image under the symmetry that
+    // brings the edges to the representative of the class. The values are
+    // those of the full table, which is about as many times larger as there
+    // are symmetries.
+    using BlockType = Block<nc, ne>;
+    static constexpr std::size_t n_cs = BlockType::n_cs;
+    static constexpr std::size_t n_es = BlockType::n_es;
+
+    static constexpr unsigned sym_bits = 6;  // at most 64 symmetries
+
+    std::vector<unsigned> symmetries;  // the stabilizer, identity first
+    // By edge coordinate: its class, shifted by sym_bits, and the symmetry
+    // that brings it to the representative, read together in one lookup
+    std::vector<uint32_t> edge_class;
+    std::vector<uint32_t> class_edge;  // representative of each class
+    std::vector<uint64_t> class_symmetries;  // which fix the representative
+    std::vector<uint32_t> corner_images;  // by symmetry and corner coordinate
+    Table table{0};
+
+    static unsigned corner_coordinate(const PackedBlockCube& cube) {
+        return cube.cclp * BlockType::n_co + cube.cco;
+    }
+    static unsigned edge_coordinate(const PackedBlockCube& cube) {
+        return cube.celp * BlockType::n_eo + cube.ceo;
+    }
+
+    SymPruningTable(const BlockType& block,
+                    const BlockMoveTable<nc, ne>& m_table) {
+        std::vector<std::vector<uint32_t>> edge_images;
+        std::vector<uint32_t> corners(n_cs), edges(n_es);
+        for (unsigned a = 0; a < 3; ++a) {
+            for (unsigned b = 0; b < 4; ++b) {
+                for (unsigned c = 0; c < 2; ++c) {
+                    for (unsigned d = 0; d < 2; ++d) {
+                        unsigned sym = symmetry_index(a, b, c, d);
+                        if (coordinate_symmetry(m_table, block.solved_packed,
+                                                sym, corner_coordinate,
+                                                corners) &&
+                            coordinate_symmetry(m_table, block.solved_packed,
+                                                sym, edge_coordinate, edges)) {
+                            symmetries.push_back(sym);
+                            corner_images.insert(corner_images.end(),
+                                                 corners.begin(),
+                                                 corners.end());
+                            edge_images.push_back(edges);
+                        }
+                    }
+                }
+            }
+        }
+        assert(symmetries.size() <= (1u << sym_bits));
+
+        // The representative of a class is its smallest edge coordinate, it
+        // is brought to itself by the identity
+        edge_class.resize(n_es);
+        for (uint32_t e = 0; e < n_es; ++e) {
+            uint32_t rep = e, rep_sym = 0;
+            for (unsigned s = 1; s < symmetries.size(); ++s) {
+                if (edge_images[s][e] < rep) {
+                    rep = edge_images[s][e];
+                    rep_sym = s;
+                }
+            }
+            if (rep == e) {
+                edge_class[e] = class_edge.size() << sym_bits;
+                class_edge.push_back(e);
+                uint64_t fixing = 0;
+                for (unsigned s = 0; s < symmetries.size(); ++s) {
+                    if (edge_images[s][e] == e) fixing |= uint64_t(1) << s;
+                }
+                class_symmetries.push_back(fixing);
+            } else {
+                edge_class[e] = edge_class[rep] | rep_sym;
+            }
+        }
+        table = Table(class_edge.size() * n_cs);
+    }
+
+    std::size_t reduce(const std::size_t i) const {
+        // Index in the reduced table of an index of the full table
+        uint32_t reduction = edge_class[i / n_cs];
+        uint32_t sym = reduction & ((1u << sym_bits) - 1);
+        return (reduction >> sym_bits) * n_cs +
+               corner_images[sym * n_cs + i % n_cs];
+    }
+
+    PackedBlockCube representative(const std::size_t i) const {
+        // A state of the entry i of the reduced table
+        unsigned e = class_edge[i / n_cs], c = i % n_cs;
+        unsigned celp = e / BlockType::n_eo, ceo = e % BlockType::n_eo;
+        unsigned cclp = c / BlockType::n_co, cco = c % BlockType::n_co;
+        return PackedBlockCube(cclp / BlockType::n_cp, celp / BlockType::n_ep,
+                               cclp, celp, cco, ceo);
+    }
+
+    std::string table_id(const BlockType& block) const {
+        return block.id + "_sym";
+    }
+
+    bool load(const BlockType& block) { return table.load(table_id(block)); }
+    void write(const BlockType& block) const { table.write(table_id(block)); }
+
+    void generate(const BlockType& block,
+                  const BlockMoveTable<nc, ne>& m_table) {
+        // Same layer by layer search as generate_depths, over the classes. A
+        // representative fixed by some symmetries has several entries with
+        // the same value, they are all set at once.
+        GeneratedDepths generated(table.n_entries);
+        auto visit = [&](const std::size_t i, const uint8_t depth) {
+            std::size_t cls = i / n_cs, c = i % n_cs;
+            bool any = false;
+            for (unsigned s = 0; s < symmetries.size(); ++s) {
+                if ((class_symmetries[cls] >> s) & 1) {
+                    any |= generated.visit(
+                        cls * n_cs + corner_images[s * n_cs + c], depth);
+                }
+            }
+            return any;
+        };
+        auto expand = [&](const std::size_t i, const uint8_t depth) {
+            PackedBlockCube cube = representative(i);
+            bool any = false;
+            for (Move move : HTM_Moves) {
+                PackedBlockCube next = cube;
+                m_table.apply(move, next);
+                any |= visit(reduce(block.index(next)), depth);
+            }
+            return any;
+        };
+        visit(reduce(block.index(block.solved_packed)), 0);
+        generate_layers(generated, expand);
+        table.assign(generated);
+    }
+
+    // Same interface as the full tables, on indices of the full table
+    auto operator[](const std::size_t i) const { return table[reduce(i)]; }
+    auto estimate(const std::size_t i) const {
+        return table.estimate(reduce(i));
+    }
+    void prefetch(const std::size_t i) const { table.prefetch(reduce(i)); }
+
+    unsigned residue(const std::size_t i) const {
+        return table.residue(reduce(i));
+    }
+    unsigned depth(const std::size_t i, const unsigned parent_depth) const {
+        return table.depth(reduce(i), parent_depth);
+    }
+    template <typename Cube, typename Mover, typename Indexer,
+              typename SolveCheck>
+    unsigned root_depth(const Cube& cube, const Mover& apply,
+                        const Indexer& index,
+                        const SolveCheck& is_solved) const {
+        auto reduced_index = [this, &index](const Cube& c) {
+            return reduce(index(c));
+        };
+        return table.root_depth(cube, apply, reduced_index, is_solved);
+    }
+};
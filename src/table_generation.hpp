@@ -0,0 +1,151 @@
+#pragma once
+#include <algorithm>  // std::min
+#include <atomic>     // shared entries and work counter
+#include <cstdint>    // uint8_t
+#include <iterator>   // std::make_move_iterator
+#include <thread>     // workers
+#include <vector>
+
+#include "move.hpp"  // HTM_Moves
+
+// Breadth first generation of pruning tables, one layer at a time, split
+// between threads. An entry is set by whichever thread reaches it first, but
+// always to its distance to solved, so the tables are the same as the serial
+// ones whatever the number of threads.
+
+struct GeneratedDepths {
+    // Distance to solved of every entry, unset entries are 0xFF. Has the
+    // estimate() of the generated tables that the packed tables assign from.
+    static constexpr uint8_t unset = 0xFF;
+    std::vector<uint8_t> depths;
+
+    GeneratedDepths(const std::size_t n_entries) : depths(n_entries, unset) {}
+
+    unsigned estimate(const std::size_t i) const { return depths[i]; }
+
+    uint8_t get(const std::size_t i) {
+        return std::atomic_ref<uint8_t>(depths[i]).load(
+            std::memory_order_relaxed);
+    }
+
+    bool visit(const std::size_t i, uint8_t depth) {
+        // Sets an unset entry, returns false when it was already set. Most
+        // entries are, so they are read before paying for the exchange.
+        std::atomic_ref<uint8_t> entry(depths[i]);
+        uint8_t expected = unset;
+        return entry.load(std::memory_order_relaxed) == unset &&
+               entry.compare_exchange_strong(expected, depth,
+                                             std::memory_order_relaxed);
+    }
+};
+
+inline unsigned generation_threads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+template <typename Work>
+void parallel_chunks(const std::size_t n, const unsigned n_threads,
+                     const Work& work, const std::size_t chunk = 1 << 14) {
+    // Calls work(begin, end, thread id) on chunks of [0, n), handed out to
+    // the threads as they finish the previous ones
+    std::atomic<std::size_t> next{0};
+    auto worker = [&](const unsigned id) {
+        for (std::size_t begin = next.fetch_add(chunk); begin < n;
+             begin = next.fetch_add(chunk)) {
+            work(begin, std::min(begin + chunk, n), id);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned id = 1; id < n_threads; ++id) {
+        workers.emplace_back(worker, id);
+    }
+    worker(0);
+    for (auto&& w : workers) {
+        w.join();
+    }
+}
+
+template <typename Expand>
+void generate_layers(GeneratedDepths& generated, const Expand& expand,
+                     const unsigned n_threads = generation_threads()) {
+    // Scans the table once per depth: expand(i, depth + 1) visits the
+    // neighbours of every entry i at depth, and returns whether it set any
+    std::atomic<bool> changed = true;
+    for (uint8_t depth = 0; changed; ++depth) {
+        changed = false;
+        parallel_chunks(generated.depths.size(), n_threads,
+                        [&](std::size_t begin, std::size_t end, unsigned) {
+                            bool any = false;
+                            for (std::size_t i = begin; i < end; ++i) {
+                                if (generated.get(i) != depth) continue;
+                                any |= expand(i, depth + 1);
+                            }
+                            if (any) changed = true;
+                        });
+    }
+}
+
+template <typename Cube, typename Mover, typename Indexer, typename FromIndex>
+GeneratedDepths generate_depths(
+    const std::size_t n_entries, const Cube& root, const Mover& apply,
+    const Indexer& index, const FromIndex& from_index,
+    const unsigned n_threads = generation_threads()) {
+    // Same table as PruningTable::generate
+    GeneratedDepths generated(n_entries);
+    generated.visit(index(root), 0);
+    auto expand = [&](const std::size_t i, const uint8_t depth) {
+        Cube cube = from_index(i);
+        bool any = false;
+        for (Move move : HTM_Moves) {
+            Cube next = cube;
+            apply(move, next);
+            any |= generated.visit(index(next), depth);
+        }
+        return any;
+    };
+    generate_layers(generated, expand, n_threads);
+    return generated;
+}
+
+template <typename Cube, typename Mover, typename Indexer>
+GeneratedDepths generate_depths_BFS(
+    const std::size_t n_entries, const Cube& root, const Mover& apply,
+    const Indexer& index, const unsigned n_threads = generation_threads()) {
+    // Same table as PruningTable::generate_BFS, for coordinates that cannot
+    // be turned back into a cube: the states of each layer are kept, each
+    // thread collects the states it sets in the next one
+    GeneratedDepths generated(n_entries);
+    generated.visit(index(root), 0);
+    std::vector<Cube> layer{root};
+    for (uint8_t depth = 1; !layer.empty(); ++depth) {
+        std::vector<std::vector<Cube>> next(n_threads);
+        parallel_chunks(layer.size(), n_threads,
+                        [&](std::size_t begin, std::size_t end, unsigned id) {
+                            for (std::size_t i = begin; i < end; ++i) {
+                                for (Move move : HTM_Moves) {
+                                    Cube cube = layer[i];
+                                    apply(move, cube);
+                                    if (generated.visit(index(cube), depth)) {
+                                        next[id].push_back(cube);
+                                    }
+                                }
+                            }
+                        });
+        // The layers of the largest tables take gigabytes: the last one is
+        // freed first, and each thread's states once they are moved
+        std::size_t n_next = 0;
+        for (auto&& states : next) {
+            n_next += states.size();
+        }
+        layer.clear();
+        layer.shrink_to_fit();
+        layer.reserve(n_next);
+        for (auto&& states : next) {
+            layer.insert(layer.end(), std::make_move_iterator(states.begin()),
+                         std::make_move_iterator(states.end()));
+            states.clear();
+            states.shrink_to_fit();
+        }
+    }
+    return generated;
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <array>
+#include <cstddef>     // size_t
+#include <cstdint>     // header fields
+#include <filesystem>  // table file paths
+#include <fstream>     // fallback when mmap is not available
+#include <memory>      // std::unique_ptr
+#include <utility>     // std::exchange
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>     // open
+#include <sys/mman.h>  // mmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // close
+#define BLOCK_SOLVER_USE_MMAP
+#endif
+
+// Number of readable bytes guaranteed past the end of every table, so that
+// SIMD gathers loading 32 bits around a 1 or 2 byte entry never fault
+constexpr size_t table_padding = 64;
+
+struct TableHeader {
+    // First bytes of a table file with a versioned format, checked before the
+    // table is mapped. The fields are in native byte order. The header is as
+    // large as a cache line, so that the entries that follow stay aligned.
+    std::array<char, 8> magic{'B', 'S', 'T', 'A', 'B', 'L', 'E', '\0'};
+    uint32_t version = 0;
+    uint32_t bits_per_entry = 0;
+    uint64_t n_entries = 0;
+    std::array<char, 40> reserved{};
+
+    bool operator==(const TableHeader&) const = default;
+};
+static_assert(sizeof(TableHeader) == 64);
+
+template <typename value_type>
+class TableStorage {
+    // Entries of a move or pruning table. A table computed at runtime lives in
+    // an owned heap buffer. A table loaded from disk is mapped read-only
+    // instead of being copied, so loading is nearly instant and the pages are
+    // shared through the page cache by every process using the same file.
+    // Writing into a mapped table is not allowed.
+    size_t n_entries;
+    std::unique_ptr<value_type[]> buffer;
+    void* mapping = nullptr;
+    size_t mapping_offset = 0;  // bytes of the file before the entries
+    value_type* data;
+
+    size_t n_bytes() const { return n_entries * sizeof(value_type); }
+    size_t n_reserved_bytes() const {
+        return mapping_offset + n_bytes() + table_padding;
+    }
+    static value_type* new_buffer(const size_t size) {
+        return new value_type[size + table_padding / sizeof(value_type)];
+    }
+
+    void unmap() {
+#ifdef BLOCK_SOLVER_USE_MMAP
+        if (mapping != nullptr) {
+            munmap(mapping, n_reserved_bytes());
+        }
+#endif
+        mapping = nullptr;
+    }
+
+   public:
+    TableStorage(const size_t size)
+        : n_entries{size}, buffer{new_buffer(size)}, data{buffer.get()} {}
+
+    TableStorage(const TableStorage&) = delete;
+    TableStorage& operator=(const TableStorage&) = delete;
+
+    TableStorage(TableStorage&& other) noexcept
+        : n_entries{other.n_entries},
+          buffer{std::move(other.buffer)},
+          mapping{std::exchange(other.mapping, nullptr)},
+          mapping_offset{other.mapping_offset},
+          data{std::exchange(other.data, nullptr)} {}
+
+    TableStorage& operator=(TableStorage&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            n_entries = other.n_entries;
+            buffer = std::move(other.buffer);
+            mapping = std::exchange(other.mapping, nullptr);
+            mapping_offset = other.mapping_offset;
+            data = std::exchange(other.data, nullptr);
+        }
+        return *this;
+    }
+
+    ~TableStorage() { unmap(); }
+
+    value_type& operator[](const size_t i) { return data[i]; }
+    const value_type& operator[](const size_t i) const { return data[i]; }
+    value_type* get() { return data; }
+    const value_type* get() const { return data; }
+    size_t size() const { return n_entries; }
+
+    void prefetch(const size_t i) const {
+        // Starts loading an entry that will be read soon
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(data + i);
+#endif
+    }
+    bool is_mapped() const { return mapping != nullptr; }
+
+    void allocate() {
+        // Replaces a mapped table by an owned buffer, before computing it
+        if (buffer == nullptr) {
+            unmap();
+            buffer.reset(new_buffer(n_entries));
+            data = buffer.get();
+        }
+    }
+
+    bool map(const std::filesystem::path& path) {
+        // Maps the table file read-only. Returns false, and leaves the table
+        // untouched, if the file is missing or does not have the expected size
+        return map_entries(path, 0);
+    }
+
+    bool map(const std::filesystem::path& path, const TableHeader& header) {
+        // Same for a file that starts with a header, which must be equal to
+        // `header`
+        std::ifstream file(path, std::ios::binary);
+        TableHeader file_header;
+        file.read(reinterpret_cast<char*>(&file_header), sizeof(TableHeader));
+        if (!file || !(file_header == header)) return false;
+        return map_entries(path, sizeof(TableHeader));
+    }
+
+    void write(const std::filesystem::path& path) const {
+        write_entries(path, nullptr);
+    }
+
+    void write(const std::filesystem::path& path,
+               const TableHeader& header) const {
+        write_entries(path, &header);
+    }
+
+   private:
+    bool map_entries(const std::filesystem::path& path, const size_t offset) {
+        // Maps the entries, which start `offset` bytes into the file
+        std::error_code error;
+        auto file_size = std::filesystem::file_size(path, error);
+        if (error || file_size != offset + n_bytes()) return false;
+
+#ifdef BLOCK_SOLVER_USE_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        // The file is mapped over the start of an anonymous reservation, which
+        // provides the padding when the file ends on a page boundary
+        const size_t n_reserved = offset + n_bytes() + table_padding;
+        void* ptr = mmap(nullptr, n_reserved, PROT_READ,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr != MAP_FAILED &&
+            mmap(ptr, offset + n_bytes(), PROT_READ, MAP_SHARED | MAP_FIXED,
+                 fd, 0) == MAP_FAILED) {
+            munmap(ptr, n_reserved);
+            ptr = MAP_FAILED;
+        }
+        close(fd);  // the mapping keeps its own reference to the file
+        if (ptr == MAP_FAILED) return false;
+
+        unmap();
+        mapping = ptr;
+        mapping_offset = offset;
+        data = reinterpret_cast<value_type*>(static_cast<char*>(ptr) + offset);
+        buffer.reset();
+        return true;
+#else
+        allocate();
+        std::ifstream istrm(path, std::ios::binary);
+        istrm.seekg(offset);
+        istrm.read(reinterpret_cast<char*>(data), n_bytes());
+        return bool(istrm);
+#endif
+    }
+
+    void write_entries(const std::filesystem::path& path,
+                       const TableHeader* header) const {
+        // The file is replaced in one step so that the tables already mapped
+        // from it, possibly by another process, are never truncated
+        auto tmp_path = path;
+        tmp_path += ".tmp";
+        {
+            std::ofstream file(tmp_path, std::ios::binary);
+            if (header != nullptr) {
+                file.write(reinterpret_cast<const char*>(header),
+                           sizeof(TableHeader));
+            }
+            file.write(reinterpret_cast<const char*>(data), n_bytes());
+        }
+        std::filesystem::rename(tmp_path, path);
+    }
+};
@@ -1,15 +1,23 @@
 #pragma once
+#include <algorithm>   // std::count
 #include <cassert>     // assert
 #include <filesystem>  // locate table files
 #include <fstream>     // write tables into files
 #include <map>         // std::map
+#include <mutex>       // std::call_once
+#include <optional>    // two gen symmetry, if any
 #include <queue>       // std::deque
 
 #include "223.hpp"  // 2x2x3 solver
 #include "coordinate.hpp"
 #include "cubie_cube.hpp"
-#include "search.hpp"     // IDAstar
-#include "step_node.hpp"  // steppers
+#include "ida_search.hpp"            // parallel IDA*
+#include "lazy_table.hpp"            // tables loaded on first use
+#include "mapped_pruning_table.hpp"  // MappedPruningTable
+#include "move_table.hpp"            // table_entry_t
+#include "parallel_steps.hpp"        // steppers on several threads
+#include "search.hpp"                // Node, make_root
+#include "table_generation.hpp"      // generate_depths_BFS
 
 namespace fs = std::filesystem;
 namespace b223 = block_solver_223;
@@ -91,8 +99,8 @@ bool is_two_gen(const CubieCube& cc) {
 }
 
 unsigned corner_index(const CubieCube& cc) {
-    static std::array<unsigned, 6> corners{ULF, URF, URB, ULB, DRF, DRB};
-    static std::array<unsigned, 6> co;
+    static const std::array<unsigned, 6> corners{ULF, URF, URB, ULB, DRF, DRB};
+    std::array<unsigned, 6> co;
 
     assert(is_two_gen(cc));
 
@@ -107,8 +115,8 @@ unsigned corner_index(const CubieCube& cc) {
 }
 
 unsigned edge_index(const CubieCube& cc) {
-    static std::array<unsigned, 7> edges{UF, UR, UB, UL, RF, RB, DR};
-    static std::array<unsigned, 7> ep;
+    static const std::array<unsigned, 7> edges{UF, UR, UB, UL, RF, RB, DR};
+    std::array<unsigned, 7> ep;
 
     assert(is_two_gen(cc));
 
@@ -148,29 +156,43 @@ std::array<Move, 6> moves{U, U2, U3, R, R2, R3};
 constexpr unsigned N_TWO_GEN_CP = factorial(5);
 constexpr unsigned N_TWO_GEN_CO = ipow(3, 5);
 constexpr unsigned N_TWO_GEN_EP = factorial(7);
-PruningTable<N_TWO_GEN_CP * N_TWO_GEN_CO> corner_ptable;
-PruningTable<N_TWO_GEN_EP> edge_ptable;
+MappedPruningTable<N_TWO_GEN_CP * N_TWO_GEN_CO> corner_ptable;
+MappedPruningTable<N_TWO_GEN_EP> edge_ptable;
 constexpr unsigned NS = b223::NS;
 
-void load_tables() {
+std::once_flag tables_loaded;
+
+void load_tables_once() {
     if (corner_ptable.load("two_gen_corners") &&
         edge_ptable.load("two_gen_edges")) {
         return;
     } else {
         std::cout << "generating..." << std::endl;
-        corner_ptable.generate_BFS(
+        PruningTable<N_TWO_GEN_CP * N_TWO_GEN_CO> corners;
+        PruningTable<N_TWO_GEN_EP> edges;
+        corners.generate_BFS(
             CubieCube(),
             [](const Move& move, CubieCube& cc) { cc.apply(move); },
             corner_index, {R, R2, R3, U, U2, U3});
-        edge_ptable.generate_BFS(
+        edges.generate_BFS(
             CubieCube(),
             [](const Move& move, CubieCube& cc) { cc.apply(move); }, edge_index,
             {R, R2, R3, U, U2, U3});
+        corner_ptable.assign(corners);
+        edge_ptable.assign(edges);
         corner_ptable.write("two_gen_corners");
         edge_ptable.write("two_gen_edges");
+        corner_ptable.load("two_gen_corners");
+        edge_ptable.load("two_gen_edges");
     }
 }
 
+void load_tables() {
+    // Tables are loaded once per process, not once per scramble, even when
+    // several threads initialize scrambles at the same time
+    std::call_once(tables_loaded, load_tables_once);
+}
+
 auto initialize(const Algorithm& scramble) {
     load_tables();
     CubieCube cc;
@@ -194,55 +216,144 @@ std::array<unsigned, NS> rotations{
     symmetry_index(2, 2, 0, 0),  // RF
 };
 
-auto solve(const Node<CubieCube>::sptr root, const unsigned& max_depth,
-           const unsigned& slackness) {
-    unsigned sym;
-    CubieCube cc = root->state;
+std::optional<unsigned> two_gen_symmetry(const CubieCube& cc) {
+    // One of the rotations from which cc is two gen, none if it is not two
+    // gen from any of them
+    std::optional<unsigned> sym;
     for (unsigned s : rotations) {
-        // Find the two_gen_rotation
         if (is_two_gen(cc.get_conjugate(s))) {
             sym = s;
         }
     }
+    return sym;
+}
 
-    auto estimate = [&sym](const CubieCube& cc) {
-        CubieCube conj = cc.get_conjugate(sym);
-        unsigned e_index = edge_ptable[edge_index(conj)];
-        unsigned c_index = corner_ptable[corner_index(conj)];
-        return std::max(e_index, c_index);
-    };
+struct Cube {
+    // A two gen cube seen from its two gen symmetry, as the coordinates of
+    // the pruning tables
+    unsigned corners;  // corner_index
+    unsigned edges;    // edge_index
+
+    bool operator==(const Cube&) const = default;
+};
 
-    auto is_solved = [](const CubieCube& cc) { return cc.is_solved(); };
-    auto apply = [&sym](const Move& move, CubieCube& cc) { cc.apply(move); };
-
-    auto directions =
-        [&sym](const Node<CubieCube>::sptr node) -> std::vector<Move> {
-        if (node->parent == nullptr) {
-            return {move_anti_conj(R, sym),  move_anti_conj(R2, sym),
-                    move_anti_conj(R3, sym), move_anti_conj(U, sym),
-                    move_anti_conj(U2, sym), move_anti_conj(U3, sym)};
-        } else if (node->last_move == move_anti_conj(R, sym) ||
-                   node->last_move == move_anti_conj(R2, sym) ||
-                   node->last_move == move_anti_conj(R3, sym)) {
-            return {move_anti_conj(U, sym), move_anti_conj(U2, sym),
-                    move_anti_conj(U3, sym)};
+struct TwoGenMoveTable {
+    // The corner and edge coordinates after each of the 6 two gen moves, in
+    // the order of `moves`. The rows are filled by a breadth first search
+    // from the solved cube, which reaches every coordinate.
+    static constexpr unsigned N_CORNERS = N_TWO_GEN_CP * N_TWO_GEN_CO;
+    TableStorage<table_entry_t<N_CORNERS>> corner_table{N_CORNERS * 6};
+    TableStorage<table_entry_t<N_TWO_GEN_EP>> edge_table{N_TWO_GEN_EP * 6};
+
+    TwoGenMoveTable() {
+        if (!this->load()) {
+            std::cout << "Two gen move tables not found, building them\n";
+            compute_table(corner_table, N_CORNERS, corner_index);
+            compute_table(edge_table, N_TWO_GEN_EP, edge_index);
+            this->write();
+            this->load();
         }
-        return {move_anti_conj(R, sym), move_anti_conj(R2, sym),
-                move_anti_conj(R3, sym)};
-    };
+    }
+
+    std::filesystem::path table_path() const {
+        return fs::current_path() / "move_tables/two_gen/";
+    }
+    bool load() {
+        return corner_table.map(table_path() / "corners.dat") &&
+               edge_table.map(table_path() / "edges.dat");
+    }
+    void write() const {
+        fs::create_directories(table_path());
+        corner_table.write(table_path() / "corners.dat");
+        edge_table.write(table_path() / "edges.dat");
+    }
+
+    template <typename Entry, typename Indexer>
+    static void compute_table(TableStorage<Entry>& table, const unsigned size,
+                              const Indexer& index) {
+        table.allocate();
+        std::vector<bool> reached(size, false);
+        std::deque<CubieCube> queue{CubieCube()};
+        reached[index(CubieCube())] = true;
+        while (!queue.empty()) {
+            CubieCube cc = queue.front();
+            queue.pop_front();
+            unsigned row = index(cc);
+            for (unsigned k = 0; k < moves.size(); ++k) {
+                CubieCube next = cc;
+                next.apply(moves[k]);
+                unsigned i = index(next);
+                table[row * moves.size() + k] = i;
+                if (!reached[i]) {
+                    reached[i] = true;
+                    queue.push_back(next);
+                }
+            }
+        }
+        assert(std::count(reached.begin(), reached.end(), true) == size);
+    }
+
+    void apply(const unsigned k, Cube& cube) const {
+        // Applies moves[k]
+        cube.corners = corner_table[cube.corners * moves.size() + k];
+        cube.edges = edge_table[cube.edges * moves.size() + k];
+    }
+};
+
+LazyTable m_table([] { return TwoGenMoveTable(); });
 
-    auto solutions = IDAstar<false>(root, apply, estimate, is_solved,
-                                    directions, max_depth, slackness);
-    return solutions;
+Cube cc_to_cube(const CubieCube& cc, const unsigned sym) {
+    CubieCube conj = cc.get_conjugate(sym);
+    return {corner_index(conj), edge_index(conj)};
 }
 
+// A lambda rather than a function, so that the default arguments survive
+// when the solver is handed to a stepper
+auto solve = [](const Node<CubieCube>::sptr root, const unsigned& max_depth,
+                const unsigned& slackness, const SearchOptions& options = {}) {
+    // The search runs on the coordinates of the cube seen from its two gen
+    // symmetry, moved by table lookups, but its moves are those of the
+    // scramble: the ones that are U and R moves once conjugated by sym. A
+    // cube that is not two gen has no coordinates, and no solutions.
+    auto two_gen_sym = two_gen_symmetry(root->state);
+    if (!two_gen_sym) return Solutions<Node<Cube>::sptr>{};
+    unsigned sym = *two_gen_sym;
+    auto& table = m_table.get();
+
+    std::array<unsigned, N_HTM_MOVES> column;  // of a move in the table
+    std::vector<Move> two_gen_moves;
+    for (Move move : {R, R2, R3, U, U2, U3}) {
+        two_gen_moves.push_back(move_anti_conj(move, sym));
+    }
+    for (unsigned k = 0; k < moves.size(); ++k) {
+        column[move_anti_conj(moves[k], sym)] = k;
+    }
+    MoveSuccessors successors(two_gen_moves);
+
+    auto apply = [&table, &column](const Move& move, Cube& cube) {
+        table.apply(column[move], cube);
+    };
+    auto estimate = [](const Cube& cube) {
+        return std::max<unsigned>(edge_ptable[cube.edges],
+                                  corner_ptable[cube.corners]);
+    };
+    static const Cube solved = cc_to_cube(CubieCube(), rotations[0]);
+    auto is_solved = [](const Cube& cube) { return cube == solved; };
+
+    SearchOptions two_gen_options = options;
+    two_gen_options.successors = &successors;
+    return ida_search(make_root(cc_to_cube(root->state, sym)), apply, estimate,
+                      is_solved, max_depth, slackness, two_gen_options);
+};
+
 }  // namespace two_gen
 
 namespace two_gen_reduction {
 
 constexpr unsigned NB = 3;
 constexpr unsigned NS = b223::NS;
-using Cube = std::array<MultiBlockCube<NB>, NS>;
+using SubCube = MultiBlockCube<NB, PackedBlockCube>;
+using Cube = std::array<SubCube, NS>;
 constexpr unsigned N_EQ_CLASSES = 336;   // 336 = 8! / 5!
 constexpr unsigned ESIZE = ipow(2, 11);  // Number of possible eo states
 constexpr unsigned N_COMB_3EDGES =
@@ -251,32 +362,40 @@ constexpr unsigned TABLE_SIZE = N_EQ_CLASSES * ESIZE * N_COMB_3EDGES;
 
 auto corner_block =
     Block<8, 0>("Corners", {ULF, URF, URB, ULB, DLF, DRF, DRB, DLB}, {});
-auto c_m_table = BlockMoveTable(corner_block);
-auto eo_m_table = EOMoveTable();
+LazyTable c_m_table([] { return BlockMoveTable(corner_block); });
+LazyTable eo_m_table([] { return EOMoveTable(); });
 std::array<unsigned, 40320> corner_equivalence_table;
-PruningTable<TABLE_SIZE> ptable;
-
-void local_apply(const Move& move, const unsigned& k,
-                 MultiBlockCube<NB>& subcube) {
-    b223::m_table.sym_apply(move, b223::rotations[k][0], subcube[0]);
-    b223::m_table.sym_apply(move, b223::rotations[k][1], subcube[1]);
-    c_m_table.sym_apply(move, two_gen::rotations[k], subcube[2]);
-    eo_m_table.sym_apply(move, two_gen::rotations[k], subcube[2]);
-}
 
-void apply(const Move& move, Cube& cube) {
-    for (unsigned k = 0; k < NS; ++k) {
-        b223::m_table.sym_apply(move, b223::rotations[k][0], cube[k][0]);
-        b223::m_table.sym_apply(move, b223::rotations[k][1], cube[k][1]);
-        c_m_table.sym_apply(move, two_gen::rotations[k], cube[k][2]);
-        eo_m_table.sym_apply(move, two_gen::rotations[k], cube[k][2]);
+struct Mover {
+    // Moves the subcubes, bound to the loaded move tables so that moving a
+    // node does not check whether they are loaded
+    const decltype(b223::m_table)::Table& m_table;
+    const decltype(c_m_table)::Table& corners;
+    const decltype(eo_m_table)::Table& eo;
+
+    void local_apply(const Move& move, const unsigned k,
+                     SubCube& subcube) const {
+        m_table.sym_apply(move, b223::rotations[k][0], subcube[0]);
+        m_table.sym_apply(move, b223::rotations[k][1], subcube[1]);
+        corners.sym_apply(move, two_gen::rotations[k], subcube[2]);
+        eo.sym_apply(move, two_gen::rotations[k], subcube[2]);
+    }
+
+    void operator()(const Move& move, Cube& cube) const {
+        for (unsigned k = 0; k < NS; ++k) {
+            local_apply(move, k, cube[k]);
+        }
     }
 };
 
-bool local_is_solved(const MultiBlockCube<NB>& subcube) {
+LazyTable apply([] {
+    return Mover{b223::m_table.get(), c_m_table.get(), eo_m_table.get()};
+});
+
+bool local_is_solved(const SubCube& subcube) {
     return (b223::block.is_solved(subcube[0]) &&
             b223::block.is_solved(subcube[1]) &&
-            corner_equivalence_table[subcube[2].ccp] == 0 &&
+            corner_equivalence_table[subcube[2].cclp] == 0 &&
             subcube[2].ceo == 0);
 }
 
@@ -288,13 +407,13 @@ auto is_solved = [](const Cube& cube) {
 };
 
 auto local_cc_initialize(const CubieCube& scramble_cc, const unsigned k) {
-    MultiBlockCube<NB> ret;
+    SubCube ret;
 
-    ret[0] = b223::block.to_coordinate_block_cube(
+    ret[0] = b223::block.to_packed_block_cube(
         scramble_cc.get_conjugate(b223::rotations[k][0]));
-    ret[1] = b223::block.to_coordinate_block_cube(
+    ret[1] = b223::block.to_packed_block_cube(
         scramble_cc.get_conjugate(b223::rotations[k][1]));
-    ret[2] = corner_block.to_coordinate_block_cube(
+    ret[2] = corner_block.to_packed_block_cube(
         scramble_cc.get_conjugate(two_gen::rotations[k]));
     ret[2].ceo =
         eo_index<NE, true>(scramble_cc.get_conjugate(two_gen::rotations[k]).eo);
@@ -312,30 +431,168 @@ auto cc_initialize(const CubieCube& scramble_cc) {
     return make_root(ret);
 }
 
-unsigned phase_2_index(const MultiBlockCube<NB>& cube) {
-    unsigned ci = corner_equivalence_table[cube[2].ccp];  // two gen corner
-                                                          // equivalence class
+unsigned phase_2_index(const SubCube& cube) {
+    // With all 8 corners the layout is fixed, so cclp is the permutation
+    unsigned ci = corner_equivalence_table[cube[2].cclp];  // two gen corner
+                                                           // equivalence class
     unsigned ei = cube[2].ceo;                            // eo state index
     unsigned cl = cube[0].cel;  // layout coordinate of the 3 edges from DL 123
     return (ci * ESIZE + ei) * N_COMB_3EDGES + cl;
 }
 
-unsigned max_estimate(const MultiBlockCube<NB>& cube) {
-    unsigned h223 =
-        std::max(b223::get_estimate(cube[0]), b223::get_estimate(cube[1]));
-    unsigned hphase2 = ptable[phase_2_index(cube)];
+unsigned max_estimate(const b223::PruningTable& p_table, const SubCube& cube,
+                      const unsigned hphase2) {
+    unsigned h223 = std::max(b223::get_estimate(p_table, cube[0]),
+                             b223::get_estimate(p_table, cube[1]));
     return std::max(h223, hphase2);
 }
 
-auto estimate = [](const Cube& cube) {
-    unsigned ret = max_estimate(cube[0]);
-    for (unsigned k = 0; k < NS; ++k) {
-        unsigned e = max_estimate(cube[k]);
-        ret = ret < e ? ret : e;
+template <typename Table>
+Table load_phase_2_table() {
+    // Needs the corner equivalence table, see load_tables
+    Table table;
+    if (!table.load("two_gen_reduction")) {
+        std::cout << "generating..." << std::endl;
+        auto generated = generate_depths_BFS(
+            TABLE_SIZE, local_cc_initialize(CubieCube(), 1),
+            [&apply = apply.get()](const Move& move, SubCube& cube) {
+                apply.local_apply(move, 1, cube);
+            },
+            phase_2_index);  // generate the pruning table
+        table.assign(generated);
+        table.write("two_gen_reduction");
+        table.load("two_gen_reduction");
+    }
+    return table;
+}
+
+LazyTable ptable(
+    [] { return load_phase_2_table<MappedPruningTable<TABLE_SIZE>>(); });
+// Used instead of ptable with -DBLOCK_SOLVER_MOD3_TABLES
+LazyTable mod3_ptable(
+    [] { return load_phase_2_table<Mod3PruningTable<TABLE_SIZE>>(); });
+
+template <typename Phase2Table>
+struct Estimator {
+    // Bound to the loaded tables, so that the lookups do not check whether
+    // they are loaded
+    const b223::PruningTable& p_table;
+    const Phase2Table& ptable;
+
+    unsigned max_estimate(const SubCube& cube) const {
+        return two_gen_reduction::max_estimate(
+            p_table, cube, ptable.estimate(phase_2_index(cube)));
+    }
+
+    bool within_budget(const SubCube& cube, const unsigned budget) const {
+        // Same as max_estimate(cube) <= budget, reading the cheap 2x2x3
+        // tables first and the phase 2 table only when they are within the
+        // budget
+        return b223::get_estimate(p_table, cube[0]) <= budget &&
+               b223::get_estimate(p_table, cube[1]) <= budget &&
+               ptable.estimate(phase_2_index(cube)) <= budget;
+    }
+
+    unsigned operator()(const Cube& cube) const {
+        unsigned ret = max_estimate(cube[0]);
+        for (unsigned k = 1; k < NS; ++k) {
+            unsigned e = max_estimate(cube[k]);
+            ret = ret < e ? ret : e;
+        }
+        return ret;
+    }
+
+    void prefetch(const Cube& cube) const {
+        for (unsigned k = 0; k < NS; ++k) {
+            p_table.prefetch(b223::block.index(cube[k][0]));
+            p_table.prefetch(b223::block.index(cube[k][1]));
+            ptable.prefetch(phase_2_index(cube[k]));
+        }
+    }
+
+    bool within(const Cube& cube, const unsigned budget) const {
+        // Stops at the first symmetry within the budget
+        for (unsigned k = 0; k < NS; ++k) {
+            if (within_budget(cube[k], budget)) return true;
+        }
+        return false;
+    }
+};
+
+LazyTable estimate([] {
+    return Estimator<decltype(ptable)::Table>{b223::p_table.get(),
+                                              ptable.get()};
+});
+
+struct DepthCube {
+    // The cube and the phase 2 depths of its symmetries, which mod3_ptable
+    // only gives relative to the depths of the parent
+    Cube cube;
+    std::array<uint8_t, NS> phase_2_depths;
+};
+
+struct DepthMover {
+    // Moves the cube and rebuilds its phase 2 depths
+    const Mover& apply;
+    const decltype(mod3_ptable)::Table& table;
+
+    void operator()(const Move& move, DepthCube& cube) const {
+        apply(move, cube.cube);
+        std::array<unsigned, NS> indices;
+        for (unsigned k = 0; k < NS; ++k) {
+            indices[k] = phase_2_index(cube.cube[k]);
+            table.prefetch(indices[k]);
+        }
+        for (unsigned k = 0; k < NS; ++k) {
+            cube.phase_2_depths[k] =
+                table.depth(indices[k], cube.phase_2_depths[k]);
+        }
     }
-    return ret;
 };
 
+LazyTable depth_apply(
+    [] { return DepthMover{apply.get(), mod3_ptable.get()}; });
+
+auto depth_is_solved = [](const DepthCube& cube) {
+    return is_solved(cube.cube);
+};
+
+struct DepthEstimator {
+    // Estimator with the phase 2 values stored in the cube
+    const b223::PruningTable& p_table;
+
+    unsigned operator()(const DepthCube& cube) const {
+        unsigned ret = max_estimate(p_table, cube.cube[0],
+                                    cube.phase_2_depths[0]);
+        for (unsigned k = 1; k < NS; ++k) {
+            unsigned e = max_estimate(p_table, cube.cube[k],
+                                      cube.phase_2_depths[k]);
+            ret = ret < e ? ret : e;
+        }
+        return ret;
+    }
+
+    void prefetch(const DepthCube& cube) const {
+        for (unsigned k = 0; k < NS; ++k) {
+            p_table.prefetch(b223::block.index(cube.cube[k][0]));
+            p_table.prefetch(b223::block.index(cube.cube[k][1]));
+        }
+    }
+
+    bool within(const DepthCube& cube, const unsigned budget) const {
+        for (unsigned k = 0; k < NS; ++k) {
+            if (cube.phase_2_depths[k] <= budget &&
+                b223::get_estimate(p_table, cube.cube[k][0]) <= budget &&
+                b223::get_estimate(p_table, cube.cube[k][1]) <= budget) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+LazyTable depth_estimate([] { return DepthEstimator{b223::p_table.get()}; });
+
 void make_corner_equivalence_table() {
     // Reduce the number of corner permutations by using an equivalence index
     // every two permutations with the same equivalence index have the same
@@ -377,22 +634,23 @@ void make_corner_equivalence_table() {
     }
 }
 
-void load_tables() {
+std::once_flag tables_loaded;
+
+void load_tables_once() {
     make_corner_equivalence_table();
-    if (ptable.load("two_gen_reduction")) {
-        return;
+    if constexpr (use_mod3_tables) {
+        mod3_ptable.get();
     } else {
-        std::cout << "generating..." << std::endl;
-        ptable.generate_BFS<true>(
-            local_cc_initialize(CubieCube(), 1),
-            [](const Move& move, MultiBlockCube<NB>& cube) {
-                local_apply(move, 1, cube);
-            },
-            phase_2_index);  // generate the pruning table
-        ptable.write("two_gen_reduction");
+        ptable.get();
     }
 }
 
+void load_tables() {
+    // Tables are loaded once per process, not once per scramble, even when
+    // several threads initialize scrambles at the same time
+    std::call_once(tables_loaded, load_tables_once);
+}
+
 auto initialize(const Algorithm& alg) {
     load_tables();
     CubieCube cc;
@@ -400,16 +658,41 @@ auto initialize(const Algorithm& alg) {
     return cc_initialize(cc);
 }
 
-auto solve(const Node<Cube>::sptr root, const unsigned& max_depth,
-           const unsigned& slackness) {
-    auto solutions =
-        IDAstar<false>(root, apply, estimate, is_solved, max_depth, slackness);
-    return solutions;
+unsigned phase_2_root_depth(const SubCube& subcube, const unsigned k) {
+    // Depth of a root in mod3_ptable, found by walking down to the solved
+    // phase 2 index through the moves of symmetry k
+    static const unsigned solved_index =
+        phase_2_index(local_cc_initialize(CubieCube(), 1));
+    return mod3_ptable.get().root_depth(
+        subcube,
+        [&apply = apply.get(), k](const Move& move, SubCube& sub) {
+            apply.local_apply(move, k, sub);
+        },
+        phase_2_index,
+        [](const SubCube& sub) { return phase_2_index(sub) == solved_index; });
 }
 
+// A lambda rather than a function, so that the default arguments survive
+// when the solver is handed to a stepper
+auto solve = [](const Node<Cube>::sptr root, const unsigned& max_depth,
+                const unsigned& slackness, const SearchOptions& options = {}) {
+    if constexpr (use_mod3_tables) {
+        DepthCube cube{root->state, {}};
+        for (unsigned k = 0; k < NS; ++k) {
+            cube.phase_2_depths[k] = phase_2_root_depth(root->state[k], k);
+        }
+        return ida_search(make_root(cube), depth_apply.get(),
+                          depth_estimate.get(), depth_is_solved, max_depth,
+                          slackness, options);
+    } else {
+        return ida_search(root, apply.get(), estimate.get(), is_solved,
+                          max_depth, slackness, options);
+    }
+};
+
 }  // namespace two_gen_reduction
 
-auto finish =
-    make_stepper(make_root<CubieCube>, two_gen::solve, STEPFINAL{}, NONISS);
-auto reduction = make_stepper(two_gen_reduction::cc_initialize,
-                              two_gen_reduction::solve, finish);
\ No newline at end of file
+auto finish = make_parallel_stepper(make_root<CubieCube>, two_gen::solve,
+                                    STEPFINAL{}, NONISS);
+auto reduction = make_parallel_stepper(two_gen_reduction::cc_initialize,
+                                       two_gen_reduction::solve, finish);
\ No newline at end of file
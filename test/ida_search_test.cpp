@@ -0,0 +1,228 @@
+#include "ida_search.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <set>
+
+#include "123.hpp"
+#include "222.hpp"
+
+template <typename NodePtr>
+std::vector<Move> get_moves(NodePtr node) {
+    std::vector<Move> moves;
+    while (node->parent != nullptr) {
+        moves.push_back(node->last_move);
+        node = node->parent;
+    }
+    std::reverse(moves.begin(), moves.end());
+    return moves;
+}
+
+template <typename Solutions>
+std::set<std::vector<Move>> get_move_set(const Solutions& solutions) {
+    std::set<std::vector<Move>> ret;
+    for (auto&& node : solutions) {
+        ret.insert(get_moves(node));
+    }
+    assert(ret.size() == solutions.size());  // no duplicates
+    return ret;
+}
+
+void test_successors() {
+    auto allowed = [](const Move last, const Move next) {
+        auto&& s = htm_successors[last];
+        return std::find(s.begin(), s.end(), next) != s.end();
+    };
+    assert(htm_successors[N_HTM_MOVES].size() == N_HTM_MOVES);
+    assert(!allowed(U, U2));
+    assert(!allowed(R3, R));
+    assert(allowed(U, R));
+    // Commuting moves are only searched in one order
+    assert(allowed(U, D) != allowed(D, U));
+    assert(allowed(R2, L) != allowed(L, R2));
+}
+
+template <typename Initializer, typename Solver>
+void test_parallel_matches_serial(const Initializer& initialize,
+                                  const Solver& solve) {
+    auto root = initialize(Algorithm("R' U' F L2 D L' B R D' B' U' D2 L'"));
+
+    for (unsigned slackness : {0, 1}) {
+        auto serial = get_move_set(solve(root, 20, slackness));
+        assert(serial.size() > 0);
+
+        for (unsigned split_depth : {0, 1, 3}) {
+            SearchOptions options;
+            options.n_threads = 4;
+            options.split_depth = split_depth;
+            auto parallel = solve(root, 20, slackness, options);
+            assert(get_move_set(parallel) == serial);
+        }
+    }
+}
+
+void test_serial_matches_idastar() {
+    // The serial search with the early exit estimator finds the same
+    // solutions as the reference IDAstar with the exact minimum
+    using namespace block_solver_222;
+    constexpr std::size_t NS = rotations.size();
+    auto m_table = BlockMoveTable(block);
+    auto p_table = load_pruning_table(block);
+    auto apply = get_sym_apply<NS>(m_table, rotations);
+    auto estimate = get_estimator<NS>(p_table, block);
+    auto is_solved = get_is_solved<NS>(block);
+
+    auto root = initialize(Algorithm("R' U' F L2 D L' B R D' B' U' D2 L'"));
+    const unsigned max_depth = 20;
+    for (unsigned slackness : {0, 1, 2}) {
+        auto reference = IDAstar<false>(root, apply, estimate, is_solved,
+                                        max_depth, slackness);
+        auto solutions = ida_search(root, apply, estimate, is_solved,
+                                    max_depth, slackness);
+        assert(get_move_set(solutions) == get_move_set(reference));
+
+        SearchOptions no_prefetch;
+        no_prefetch.prefetch = false;
+        auto unprefetched = ida_search(root, apply, estimate, is_solved,
+                                       max_depth, slackness, no_prefetch);
+        assert(get_move_set(unprefetched) == get_move_set(reference));
+    }
+
+    // within(cube, budget) agrees with the exact estimate on every node
+    // around the root
+    for (Move move : HTM_Moves) {
+        for (Move next : HTM_Moves) {
+            auto cube = root->state;
+            apply(move, cube);
+            apply(next, cube);
+            unsigned e = estimate(cube);
+            for (unsigned budget = 0; budget < 10; ++budget) {
+                assert(estimate.within(cube, budget) == (e <= budget));
+            }
+        }
+    }
+}
+
+void test_stats() {
+    // The counters of a search don't depend on the number of threads
+    auto root = block_solver_222::initialize(
+        Algorithm("R' U' F L2 D L' B R D' B' U' D2 L'"));
+    SearchStats serial, parallel;
+    size_t n_solutions;
+    {
+        CollectStats collect(serial);
+        n_solutions = block_solver_222::solve(root, 20, 1).size();
+    }
+    {
+        CollectStats collect(parallel);
+        SearchOptions options;
+        options.n_threads = 4;
+        block_solver_222::solve(root, 20, 1, options);
+    }
+    assert(collected_stats == nullptr);
+    if constexpr (search_stats_enabled) {
+        assert(serial.solutions == n_solutions);
+        assert(serial.nodes > 0 && serial.nodes == parallel.nodes);
+        assert(serial.iteration_nodes == parallel.iteration_nodes);
+        assert(serial.solutions == parallel.solutions);
+        assert(serial.is_solved_checks == parallel.is_solved_checks);
+    } else {
+        assert(serial.nodes == 0 && serial.solutions == 0);
+    }
+}
+
+void test_budget() {
+    // The searches stop with the solutions found so far once their budget
+    // runs out, on one thread or several
+    auto root = block_solver_222::initialize(
+        Algorithm("R' U' F L2 D L' B R D' B' U' D2 L'"));
+    auto all = get_move_set(block_solver_222::solve(root, 20, 2));
+    SearchOptions parallel;
+    parallel.n_threads = 4;
+
+    for (auto options : {SearchOptions{}, parallel}) {
+        std::atomic<bool> cancelled = true;
+        SearchBudget cancel;
+        cancel.cancel = &cancelled;
+        {
+            BudgetWith spend(cancel);
+            assert(search_budget == &cancel);
+            assert(block_solver_222::solve(root, 20, 2, options).size() == 0);
+        }
+        assert(search_budget == nullptr && cancel.is_stopped());
+
+        SearchBudget nodes;
+        nodes.max_nodes = 20000;
+        BudgetWith spend(nodes);
+        auto some = get_move_set(block_solver_222::solve(root, 20, 2, options));
+        assert(nodes.is_stopped() && some.size() < all.size());
+        for (auto&& solution : some) {
+            assert(all.contains(solution));
+        }
+    }
+
+    // A budget within another one stops with it
+    SearchBudget outer, inner;
+    outer.deadline = SearchBudget::clock::now();
+    {
+        BudgetWith spend_outer(outer);
+        BudgetWith spend_inner(inner);
+        assert(inner.parent == &outer);
+        assert(block_solver_222::solve(root, 20, 2).size() == 0);
+        assert(inner.is_stopped());
+    }
+
+    // The nodes of a budget within another one are also charged to it, even
+    // when its own limit is reached first
+    SearchBudget parent, child;
+    child.max_nodes = 20000;
+    {
+        BudgetWith spend_parent(parent);
+        BudgetWith spend_child(child);
+        block_solver_222::solve(root, 20, 2);
+        assert(child.is_stopped() && !parent.is_stopped());
+    }
+    assert(parent.nodes == child.nodes && parent.nodes > child.max_nodes);
+
+    // An unlimited budget finds every solution
+    SearchBudget unlimited;
+    BudgetWith spend(unlimited);
+    assert(get_move_set(block_solver_222::solve(root, 20, 2)) == all);
+    assert(!unlimited.is_stopped() && unlimited.nodes > 0);
+}
+
+void test_sink() {
+    // A sink gets the solutions in the order they are returned without it,
+    // whatever the number of threads
+    auto root = block_solver_222::initialize(
+        Algorithm("R' U' F L2 D L' B R D' B' U' D2 L'"));
+    std::vector<std::vector<Move>> expected;
+    for (auto&& node : block_solver_222::solve(root, 20, 2)) {
+        expected.push_back(get_moves(node));
+    }
+
+    for (unsigned n_threads : {1, 4}) {
+        std::vector<std::vector<Move>> streamed;
+        SearchOptions options;
+        options.n_threads = n_threads;
+        options.sink = [&](const std::vector<Move>& path) {
+            streamed.push_back(path);
+        };
+        assert(block_solver_222::solve(root, 20, 2, options).size() == 0);
+        assert(streamed == expected);
+    }
+}
+
+int main() {
+    test_successors();
+    test_serial_matches_idastar();
+    test_stats();
+    test_budget();
+    test_sink();
+    test_parallel_matches_serial(block_solver_222::initialize,
+                                 block_solver_222::solve);
+    test_parallel_matches_serial(block_solver_123::initialize,
+                                 block_solver_123::solve);
+    return 0;
+}
@@ -64,8 +64,8 @@ void test_222_block_alg_apply() {
 void test_load() {
     BlockMoveTable<4, 4> table;
     Block<4, 4> b("TopLayer", {ULF, URF, URB, ULB}, {UF, UR, UB, UL});
-    table.compute_corner_move_tables(b);
-    table.compute_edge_move_tables(b);
+    table.compute_corner_move_tables();
+    table.compute_edge_move_tables();
     table.write(table.block_table_path(b));
 
     BlockMoveTable<4, 4> table_loaded(b);
@@ -171,6 +171,121 @@ void test_to_cubie_cube() {
     }
 }
 
+template <typename Block>
+void test_packed_apply(Block&& b) {
+    // Packed cubes follow the unpacked ones move for move
+    BlockMoveTable table(b);
+
+    auto random = CubieCube::random_state();
+
+    for (unsigned s = 0; s < N_SYM; ++s) {
+        auto cc_conj = random.get_conjugate(s);
+        auto cbc = b.to_coordinate_block_cube(cc_conj);
+        auto pbc = b.to_packed_block_cube(cc_conj);
+
+        for (Move move : HTM_Moves) {
+            table.sym_apply(move, s, cbc);
+            table.sym_apply(move, s, pbc);
+
+            assert(b.unpack(pbc) == cbc);
+            assert(b.pack(cbc) == pbc);
+            assert(b.index(pbc) == b.index(cbc));
+        }
+    }
+
+    auto pbc = b.to_packed_block_cube(CubieCube());
+    assert(b.is_solved(pbc));
+    table.apply(R, pbc);
+    assert(!b.is_solved(pbc));
+}
+
+void test_entry_types() {
+    // 1x2x3 block: 2 corners and 3 edges
+    using Table = BlockMoveTable<2, 3>;
+    static_assert(sizeof(Table::cp_entry) == 1);  // 28 * 2 = 56 values
+    static_assert(sizeof(Table::co_entry) == 1);  // 9 values
+    static_assert(sizeof(Table::ep_entry) == 2);  // 220 * 6 = 1320 values
+    static_assert(sizeof(Table::eo_entry) == 1);  // 8 values
+
+    static_assert(sizeof(BlockMoveTable<8, 0>::cp_entry) == 2);  // 8!
+    static_assert(sizeof(BlockMoveTable<0, 7>::ep_entry) == 4);  // 792 * 7!
+
+    // The table files are written and mapped with the same entry types
+    Block<2, 3> b("DL_123", {DLF, DLB}, {DL, LF, LB});
+    Table computed;
+    computed.compute_corner_move_tables();
+    computed.compute_edge_move_tables();
+    computed.write(computed.block_table_path(b));
+
+    Table loaded(b);
+    assert(loaded.cp_table.is_mapped() && loaded.ep_table.is_mapped());
+    for (unsigned i = 0; i < Table::cp_table_size; ++i) {
+        assert(computed.cp_table[i] == loaded.cp_table[i]);
+    }
+    for (unsigned i = 0; i < Table::ep_table_size; ++i) {
+        assert(computed.ep_table[i] == loaded.ep_table[i]);
+    }
+}
+
+template <unsigned nc, unsigned ne>
+void test_direct_tables(Block<nc, ne>&& b) {
+    // The tables built on coordinate arrays hold the entries found by moving
+    // the cubie cube of every row
+    BlockMoveTable<nc, ne> table;
+    table.compute_corner_move_tables();
+    table.compute_edge_move_tables();
+    using Table = BlockMoveTable<nc, ne>;
+
+    auto moved = [&b](CoordinateBlockCube cbc, const Move move) {
+        CubieCube cc = b.to_cubie_cube(cbc);
+        cc.corner_apply(move_cc[move]);
+        cc.edge_apply(move_cc[move]);
+        return b.to_coordinate_block_cube(cc);
+    };
+    for (unsigned il = 0; il < Table::n_cl; ++il) {
+        for (Move move : HTM_Moves) {
+            for (unsigned ip = 0; ip < Table::n_cp; ++ip) {
+                auto cbc = moved(CoordinateBlockCube(il, 0, ip, 0, 0, 0), move);
+                if constexpr (nc > 0) {
+                    assert(table.cp_table[N_HTM_MOVES *
+                                              (il * Table::n_cp + ip) +
+                                          move] ==
+                           cbc.ccl * Table::n_cp + cbc.ccp);
+                }
+            }
+            for (unsigned io = 0; io < Table::n_co; ++io) {
+                auto cbc = moved(CoordinateBlockCube(il, 0, 0, 0, io, 0), move);
+                if constexpr (nc > 0) {
+                    assert(table.co_table[N_HTM_MOVES *
+                                              (il * Table::n_co + io) +
+                                          move] == cbc.cco);
+                }
+            }
+        }
+    }
+    for (unsigned il = 0; il < Table::n_el; ++il) {
+        for (Move move : HTM_Moves) {
+            for (unsigned ip = 0; ip < Table::n_ep; ++ip) {
+                auto cbc = moved(CoordinateBlockCube(0, il, 0, ip, 0, 0), move);
+                if constexpr (ne > 0) {
+                    assert(table.ep_table[N_HTM_MOVES *
+                                              (il * Table::n_ep + ip) +
+                                          move] ==
+                           cbc.cel * Table::n_ep + cbc.cep);
+                }
+            }
+            for (unsigned io = 0; io < Table::n_eo; ++io) {
+                auto cbc = moved(CoordinateBlockCube(0, il, 0, 0, 0, io), move);
+                if constexpr (ne > 0) {
+                    assert(table.eo_table[N_HTM_MOVES *
+                                              (il * Table::n_eo + io) +
+                                          move] == cbc.ceo);
+                }
+            }
+        }
+    }
+}
+
 int main() {
     test_move_table_apply(Block<8, 0>(
         "AllCorners", {ULF, URF, URB, ULB, DLF, DRF, DRB, DLB}, {}));
@@ -183,7 +298,15 @@ int main() {
         Block<2, 5>("DL_223", {DLF, DLB}, {LF, LB, DF, DB, DL}));
     test_load();
     test_eo_table();
+    test_entry_types();
+    test_direct_tables(Block<8, 0>(
+        "AllCorners", {ULF, URF, URB, ULB, DLF, DRF, DRB, DLB}, {}));
+    test_direct_tables(Block<0, 4>("BottomCross", {}, {DF, DR, DB, DL}));
+    test_direct_tables(Block<2, 5>("DL_223", {DLF, DLB}, {LF, LB, DF, DB, DL}));
     test_sym_apply(Block<2, 5>("DL_223", {DLF, DLB}, {LF, LB, DF, DB, DL}));
     test_eo_sym_apply();
+    test_packed_apply(Block<2, 3>("DB_123", {DLB, DRB}, {DB, RB, LB}));
+    test_packed_apply(Block<8, 0>(
+        "Corners", {ULF, URF, URB, ULB, DLF, DRF, DRB, DLB}, {}));
     return 0;
 }
\ No newline at end of file
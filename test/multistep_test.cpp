@@ -1,11 +1,96 @@
 #include "multistep.hpp"
 
+#include <algorithm>
+#include <cassert>
+
 #include "222.hpp"
 #include "223.hpp"
 #include "F2L-1.hpp"
 #include "algorithm.hpp"
 
+template <typename Solutions>
+std::vector<std::vector<Move>> get_paths(const Solutions& solutions) {
+    std::vector<std::vector<Move>> paths;
+    for (auto node : solutions) {
+        std::vector<Move> path;
+        for (; node->parent != nullptr; node = node->parent) {
+            path.push_back(node->last_move);
+        }
+        std::reverse(path.begin(), path.end());
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+void test_step_cache() {
+    // Raising or lowering the depth of a cached step gives the solutions of
+    // a single search, in the same order
+    CubieCube cc(Algorithm("R' U' F L2 D L' B R D' B' U' D2 L'"));
+    for (unsigned slackness : {0, 1, 2}) {
+        StepCache cache(block_solver_222::cc_initialize,
+                        block_solver_222::solve);
+        for (unsigned max_depth : {0, 3, 4, 5, 6, 8, 9, 5, 2, 7}) {
+            auto expected = block_solver_222::solve(
+                block_solver_222::cc_initialize(cc), max_depth, slackness);
+            assert(get_paths(cache(cc, max_depth, slackness)) ==
+                   get_paths(expected));
+        }
+    }
+}
+
+void test_transpositions() {
+    // Two skeletons which reach the same state search it once
+    unsigned n_searches = 0;
+    auto counted_solve = [&n_searches](auto root, unsigned max_depth,
+                                       unsigned slackness,
+                                       const SearchOptions& options) {
+        ++n_searches;
+        return block_solver_223::solve(root, max_depth, slackness, options);
+    };
+    auto initialize = [](const CubieCube& cc) {
+        return block_solver_223::cc_initialize(cc);
+    };
+    StepCache cache(initialize, counted_solve);
+    CubieCube cc(Algorithm("R' U' F L2 D L' B R D' B' U' D2 L' U D"));
+    CubieCube transposed(Algorithm("R' U' F L2 D L' B R D' B' U' D2 L' D U"));
+    auto paths = get_paths(cache(cc, 8, 0));
+    assert(n_searches == 1);
+    assert(get_paths(cache(transposed, 8, 0)) == paths);
+    assert(n_searches == 1);
+}
+
+void test_best_first() {
+    // Every skeleton found is a shortest one, and none is found below it
+    CubieCube cc(Algorithm("R' U' F L2 D L' B R D' B' U' D2 L' U2 L B2"));
+    auto solutions = multistep(cc, 20, 5000, 1);
+    assert(solutions.size() > 0);
+    unsigned length = solutions.front()->depth;
+    for (auto&& node : solutions) {
+        assert(node->depth == length);
+        assert(node->parent->parent->parent->parent == nullptr);
+    }
+    assert(multistep(cc, length - 1, 5000, 1).empty());
+
+    // The workers find the same skeletons, in the same order
+    auto threaded = multistep(cc, 20, 5000, 1, 3);
+    assert(threaded.size() == solutions.size());
+    for (unsigned k = 0; k < solutions.size(); ++k) {
+        for (auto a = solutions[k], b = threaded[k]; a != nullptr;
+             a = a->parent, b = b->parent) {
+            assert(a->seq.sequence == b->seq.sequence);
+        }
+    }
+
+    // A narrow beam still completes a skeleton, maybe a longer one
+    auto narrow = multistep(cc, 20, 1, 1);
+    assert(narrow.size() > 0 && narrow.front()->depth >= length);
+}
+
 int main() {
+    test_step_cache();
+    test_transpositions();
+    test_best_first();
+
     auto scramble = Algorithm(
         "R' U' F L2 D L' B R D' B' U' D2 L' U2 L B2 R2 B2 U2 F' L B2 "
         "R' U' "
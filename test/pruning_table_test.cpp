@@ -1,8 +1,19 @@
 #include "pruning_table.hpp"
 
+#include <atomic>
+#include <cstdlib>  // std::rand
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
 #include "block.hpp"
 #include "cubie_cube.hpp"
+#include "lazy_table.hpp"
+#include "mapped_pruning_table.hpp"
 #include "move_table.hpp"
+#include "sym_pruning_table.hpp"
+#include "table_generation.hpp"
 
 void test_generate() {
     auto b = Block<1, 3>("DLB_222", {DLB}, {DL, LB, DB});
@@ -55,8 +66,263 @@ void test_EO_generate() {
     }
 }
 
+void test_mapped() {
+    auto b = Block<1, 3>("DLB_222", {DLB}, {DL, LB, DB});
+    auto mtable = BlockMoveTable(b);
+
+    constexpr size_t table_size = b.n_es * b.n_cs;
+    PruningTable<table_size> ptable;
+    auto root = b.to_coordinate_block_cube(CubieCube());
+    ptable.generate(root, mtable.get_apply(), b.get_indexer(),
+                    b.get_from_index());
+
+    MappedPruningTable<table_size> mapped;
+    mapped.assign(ptable);
+    assert(!mapped.table.is_mapped());
+    mapped.write(b.id);
+
+    MappedPruningTable<table_size> reload;
+    assert(reload.load(b.id));
+    assert(reload.table.is_mapped());
+    for (unsigned i = 0; i < table_size; ++i) {
+        assert(ptable.estimate(i) == reload.estimate(i));
+    }
+
+    // A file of the wrong size is rejected
+    MappedPruningTable<table_size + 1> wrong_size;
+    assert(!wrong_size.load(b.id));
+}
+
+struct FakeTable {
+    unsigned estimate(const size_t i) const { return i % 20; }
+};
+
+void test_packed_format() {
+    // Odd number of entries, and values above the 4 bit range
+    MappedPruningTable<101> packed;
+    packed.assign(FakeTable());
+    for (unsigned i = 0; i < 101; ++i) {
+        unsigned value = i % 20;
+        assert(packed.estimate(i) == (value < 15 ? value : 15));
+    }
+    packed.write("packed_test");
+
+    MappedPruningTable<101> reload;
+    assert(reload.load("packed_test"));
+    for (unsigned i = 0; i < 101; ++i) {
+        assert(reload.estimate(i) == packed.estimate(i));
+    }
+
+    // A file without the header, as written by the older versions, is not
+    // loaded even when its size could match
+    std::filesystem::path old_path = MappedPruningTable<128>::table_path("old");
+    {
+        std::ofstream file(old_path, std::ios::binary);
+        std::vector<char> entries(64 + 64, 0);
+        file.write(entries.data(), entries.size());
+    }
+    MappedPruningTable<128> old;
+    assert(!old.load("old"));
+
+    // Neither is a file with another version
+    auto header = packed.header();
+    header.version += 1;
+    packed.table.write(MappedPruningTable<101>::table_path("packed_test"),
+                       header);
+    assert(!reload.load("packed_test"));
+}
+
+void test_mod3() {
+    auto b = Block<1, 3>("DLB_222", {DLB}, {DL, LB, DB});
+    auto mtable = BlockMoveTable(b);
+
+    constexpr size_t table_size = b.n_es * b.n_cs;
+    PruningTable<table_size> ptable;
+    auto root = b.to_coordinate_block_cube(CubieCube());
+    ptable.generate(root, mtable.get_apply(), b.get_indexer(),
+                    b.get_from_index());
+
+    // Odd number of entries, not a multiple of 4
+    Mod3PruningTable<101> packed;
+    packed.assign(FakeTable());
+    for (unsigned i = 0; i < 101; ++i) {
+        assert(packed.residue(i) == i % 20 % 3);
+    }
+
+    Mod3PruningTable<table_size> mod3;
+    mod3.assign(ptable);
+    mod3.write(b.id);
+    Mod3PruningTable<table_size> reload;
+    assert(reload.load(b.id));
+    for (unsigned i = 0; i < table_size; ++i) {
+        assert(reload.residue(i) == ptable.estimate(i) % 3);
+    }
+
+    // The depths rebuilt along a random walk are the depths of the table
+    auto apply = mtable.get_apply();
+    auto index = b.get_indexer();
+    auto is_solved = b.get_is_solved();
+    CoordinateBlockCube cube = root;
+    unsigned depth = 0;
+    std::srand(0);
+    for (unsigned n = 0; n < 1000; ++n) {
+        apply(HTM_Moves[std::rand() % N_HTM_MOVES], cube);
+        depth = reload.depth(index(cube), depth);
+        assert(depth == ptable.estimate(index(cube)));
+        assert(reload.root_depth(cube, apply, index, is_solved) == depth);
+    }
+}
+
+void test_mod3_BFS() {
+    // Same as test_mod3 on a table made by generate_depths_BFS, as the two gen
+    // reduction table is: the depths rebuilt from the residues, in a cube
+    // which carries them, are the depths of the nibble table
+    auto b = Block<1, 3>("DLB_222", {DLB}, {DL, LB, DB});
+    auto mtable = BlockMoveTable(b);
+    auto apply = mtable.get_apply();
+    auto index = b.get_indexer();
+    auto is_solved = b.get_is_solved();
+
+    constexpr size_t table_size = b.n_es * b.n_cs;
+    auto root = b.to_coordinate_block_cube(CubieCube());
+    auto generated = generate_depths_BFS(table_size, root, apply, index);
+    MappedPruningTable<table_size> nibble;
+    nibble.assign(generated);
+    Mod3PruningTable<table_size> mod3;
+    mod3.assign(generated);
+
+    struct DepthCube {
+        CoordinateBlockCube cube;
+        unsigned depth;
+    };
+    auto depth_apply = [&](const Move& move, DepthCube& cube) {
+        apply(move, cube.cube);
+        cube.depth = mod3.depth(index(cube.cube), cube.depth);
+    };
+
+    std::srand(1);
+    for (unsigned n = 0; n < 20; ++n) {
+        // Each walk starts from a root whose depth is found by root_depth
+        DepthCube cube{root, 0};
+        for (unsigned k = 0; k < 10; ++k) {
+            apply(HTM_Moves[std::rand() % N_HTM_MOVES], cube.cube);
+        }
+        cube.depth = mod3.root_depth(cube.cube, apply, index, is_solved);
+        assert(cube.depth == nibble[index(cube.cube)]);
+        for (unsigned k = 0; k < 100; ++k) {
+            depth_apply(HTM_Moves[std::rand() % N_HTM_MOVES], cube);
+            assert(cube.depth == nibble[index(cube.cube)]);
+        }
+    }
+
+    // A corrupted table stops the walk instead of looping forever: with
+    // every residue 0, no neighbour has the residue 2 of a closer state
+    struct ZeroTable {
+        unsigned estimate(const size_t) const { return 0; }
+    };
+    mod3.assign(ZeroTable());
+    CoordinateBlockCube cube = root;
+    apply(D, cube);
+    assert(!is_solved(cube));
+    assert(mod3.root_depth(cube, apply, index, is_solved) == 0);
+}
+
+template <unsigned nc, unsigned ne>
+void check_sym_reduced(Block<nc, ne> b) {
+    // The reduced table has the values of the full one
+    auto mtable = BlockMoveTable(b);
+
+    constexpr size_t table_size = b.n_es * b.n_cs;
+    PruningTable<table_size> full;
+    auto root = b.to_coordinate_block_cube(CubieCube());
+    full.generate(root, mtable.get_apply(), b.get_indexer(),
+                  b.get_from_index());
+
+    SymPruningTable<nc, ne> reduced(b, mtable);
+    assert(reduced.symmetries.size() > 1);
+    assert(reduced.table.n_entries < table_size);
+    reduced.generate(b, mtable);
+    reduced.write(b);
+
+    SymPruningTable<nc, ne> reload(b, mtable);
+    assert(reload.load(b));
+    for (unsigned i = 0; i < table_size; ++i) {
+        assert(reload.estimate(i) == full.estimate(i));
+    }
+
+    SymPruningTable<nc, ne, Mod3Table> mod3(b, mtable);
+    mod3.generate(b, mtable);
+    for (unsigned i = 0; i < table_size; ++i) {
+        assert(mod3.residue(i) == full.estimate(i) % 3);
+    }
+}
+
+void test_sym_reduced() {
+    check_sym_reduced(Block<1, 3>("DLB_222", {DLB}, {DL, LB, DB}));
+    check_sym_reduced(Block<2, 3>("DB_123", {DLB, DRB}, {DB, RB, LB}));
+}
+
+void test_parallel_generation() {
+    // The same tables as the serial generators, whatever the number of
+    // threads
+    auto b = Block<1, 3>("DLB_222", {DLB}, {DL, LB, DB});
+    auto mtable = BlockMoveTable(b);
+
+    constexpr size_t table_size = b.n_es * b.n_cs;
+    auto root = b.to_coordinate_block_cube(CubieCube());
+    PruningTable<table_size> serial, serial_BFS;
+    serial.generate(root, mtable.get_apply(), b.get_indexer(),
+                    b.get_from_index());
+    serial_BFS.generate_BFS(root, mtable.get_apply(), b.get_indexer());
+
+    for (unsigned n_threads : {1, 4}) {
+        auto generated =
+            generate_depths(table_size, root, mtable.get_apply(),
+                            b.get_indexer(), b.get_from_index(), n_threads);
+        auto generated_BFS = generate_depths_BFS(
+            table_size, root, mtable.get_apply(), b.get_indexer(), n_threads);
+        for (unsigned i = 0; i < table_size; ++i) {
+            assert(generated.estimate(i) == serial.estimate(i));
+            assert(generated_BFS.estimate(i) == serial_BFS.estimate(i));
+        }
+    }
+}
+
+void test_lazy_table() {
+    // The table is loaded by the first get(), once for all the threads
+    auto b = Block<1, 3>("DLB_222", {DLB}, {DL, LB, DB});
+    std::atomic<unsigned> n_loads = 0;
+    LazyTable m_table([&b, &n_loads] {
+        ++n_loads;
+        return BlockMoveTable(b);
+    });
+    assert(!m_table.is_loaded() && n_loads == 0);
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; ++t) {
+        threads.emplace_back([&m_table, &b] {
+            auto cube = b.solved;
+            m_table.get().apply(L, cube);
+            assert(!b.is_solved(cube));
+            m_table.get().apply(L3, cube);
+            assert(b.is_solved(cube));
+        });
+    }
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+    assert(m_table.is_loaded() && n_loads == 1);
+}
+
 int main() {
     test_generate();
     test_EO_generate();
+    test_mapped();
+    test_packed_format();
+    test_mod3();
+    test_mod3_BFS();
+    test_sym_reduced();
+    test_parallel_generation();
+    test_lazy_table();
     return 0;
 }
\ No newline at end of file
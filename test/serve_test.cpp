@@ -0,0 +1,168 @@
+#include "serve.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+
+std::string join(const std::vector<std::string>& args) {
+    std::string joined;
+    for (auto&& arg : args) {
+        joined += (joined.empty() ? "" : " ") + arg;
+    }
+    return joined;
+}
+
+Report fake_solve(const std::vector<std::string>& args,
+                  const ReportSink& emit) {
+    // "echo" prints its arguments, "fail" throws, "block" runs until its
+    // request is cancelled and "stream" emits its arguments one by one
+    if (args[0] == "fail") throw std::invalid_argument("invalid step fail");
+    if (args[0] == "stream") {
+        for (auto&& arg : args) {
+            emit([arg](std::ostream& out) { out << arg << std::endl; });
+        }
+        return [](std::ostream& out) { out << "end" << std::endl; };
+    }
+    if (args[0] == "block") {
+        while (!search_stopped()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return [](std::ostream& out) { out << "stopped" << std::endl; };
+    }
+    auto line = join(args);
+    return [line](std::ostream& out) { out << line << std::endl; };
+}
+
+void test_parse() {
+    assert((split_fields("a\t\tb\t", '\t') ==
+            std::vector<std::string>{"a", "b"}));
+
+    auto request = parse_solve_request(
+        split_fields("solve\t7\tF2L-1 -s 1\tR U F", '\t'));
+    assert(request != nullptr);
+    assert(request->id == "7");
+    assert((request->args ==
+            std::vector<std::string>{"F2L-1", "-s", "1", "R U F"}));
+    assert(!request->cancelled);
+
+    assert(parse_solve_request(split_fields("solve\t7\tR U", '\t')) ==
+           nullptr);
+    assert(parse_solve_request(split_fields("solve\t7\t \tR U", '\t')) ==
+           nullptr);
+
+    assert(report_text(fake_solve({"echo", "R"}, nullptr)) == "echo R\n");
+}
+
+#ifdef BLOCK_SOLVER_SERVE
+struct Client {
+    int fd;
+    std::string buffer;
+
+    void write_line(const std::string& line) {
+        std::string message = line + "\n";
+        assert(write(fd, message.data(), message.size()) ==
+               ssize_t(message.size()));
+    }
+
+    std::string read_line() {
+        std::size_t end;
+        while ((end = buffer.find('\n')) == std::string::npos) {
+            char chunk[256];
+            ssize_t n = read(fd, chunk, sizeof(chunk));
+            assert(n > 0);
+            buffer.append(chunk, n);
+        }
+        std::string line = buffer.substr(0, end);
+        buffer.erase(0, end + 1);
+        return line;
+    }
+};
+
+void test_connection() {
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    ServePool pool(fake_solve, 2);
+    std::thread server([&pool, fd = fds[0]] {
+        serve_connection(std::make_shared<ServeConnection>(fd), pool);
+    });
+    Client client{fds[1]};
+
+    // Every line of the answer is prefixed by the id of the request
+    client.write_line("solve\t1\techo -s 1\tR U");
+    assert(client.read_line() == "1\techo -s 1 R U");
+    assert(client.read_line() == "1\tdone");
+
+    // Emitted lines come before the report
+    client.write_line("solve\t8\tstream -s\tR U");
+    for (auto line : {"stream", "-s", "R U", "end", "done"}) {
+        assert(client.read_line() == std::string("8\t") + line);
+    }
+
+    client.write_line("solve\t2\tfail\tR");
+    assert(client.read_line() == "2\terror\tinvalid step fail");
+
+    client.write_line("solve\t3");
+    assert(client.read_line() == "3\terror\tmalformed request");
+    client.write_line("cancel\t4");
+    assert(client.read_line() == "4\terror\tno pending request");
+    client.write_line("hello");
+    assert(client.read_line() == "?\terror\tunknown command");
+
+    // A running request stops when it is cancelled, and another one is
+    // answered in the meantime
+    client.write_line("solve\t5\tblock\tR");
+    client.write_line("solve\t6\techo\tU");
+    assert(client.read_line() == "6\techo U");
+    assert(client.read_line() == "6\tdone");
+    client.write_line("solve\t5\techo\tU");
+    assert(client.read_line() == "5\terror\tid already in use");
+    client.write_line("cancel\t5");
+    assert(client.read_line() == "5\tstopped");
+    assert(client.read_line() == "5\tcancelled");
+
+    // Closing the connection cancels the pending requests
+    client.write_line("solve\t7\tblock\tR");
+    close(client.fd);
+    server.join();
+}
+
+void test_serve_exit() {
+    // Once accept fails, serve hangs up the open connections and returns
+    // after their threads
+    std::string path = "serve_test.sock";
+    int listen_fd = listen_unix(path.c_str());
+    assert(listen_fd >= 0);
+    int result = 0;
+    std::thread server([&result, listen_fd] {
+        result = serve(listen_fd, fake_solve, 2);
+    });
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+    Client client{socket(AF_UNIX, SOCK_STREAM, 0)};
+    assert(connect(client.fd, (sockaddr*)&address, sizeof(address)) == 0);
+    client.write_line("solve\t1\techo\tR");
+    assert(client.read_line() == "1\techo R");
+    assert(client.read_line() == "1\tdone");
+
+    shutdown(listen_fd, SHUT_RDWR);
+    server.join();
+    assert(result == 1);
+    char byte;
+    assert(read(client.fd, &byte, 1) == 0);
+    close(client.fd);
+    close(listen_fd);
+    unlink(path.c_str());
+}
+#endif
+
+int main() {
+    test_parse();
+#ifdef BLOCK_SOLVER_SERVE
+    std::signal(SIGPIPE, SIG_IGN);  // as in serve()
+    test_connection();
+    test_serve_exit();
+#endif
+    return 0;
+}
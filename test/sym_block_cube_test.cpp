@@ -0,0 +1,92 @@
+#include "sym_block_cube.hpp"
+
+#include <cassert>
+
+template <std::size_t NS, typename Block>
+void test_sym_apply(Block&& b, const SimdLevel level) {
+    // Every kernel moves each symmetry copy like BlockMoveTable::sym_apply
+    BlockMoveTable table(b);
+    std::array<unsigned, NS> rotations;
+    for (unsigned k = 0; k < NS; ++k) {
+        rotations[k] = (5 * k) % N_SYM;
+    }
+    SymMoveTable sym_table(table, rotations);
+
+    auto cc = CubieCube::random_state();
+    auto cube = make_sym_block_cube(b, cc, rotations);
+    std::array<PackedBlockCube, NS> reference;
+    for (unsigned k = 0; k < NS; ++k) {
+        reference[k] = b.to_packed_block_cube(cc.get_conjugate(rotations[k]));
+        assert(cube[k] == reference[k]);
+    }
+
+    simd_level = level;
+    Algorithm alg("R U2 F' L D B2 R' U F2 D' L2 B U' R2 F D2 L' B'");
+    for (Move move : alg.sequence) {
+        sym_table.apply(move, cube);
+        for (unsigned k = 0; k < NS; ++k) {
+            table.sym_apply(move, rotations[k], reference[k]);
+            assert(cube[k] == reference[k]);
+            assert(cube.ccl[k] == reference[k].ccl);
+            assert(cube.cel[k] == reference[k].cel);
+        }
+    }
+    simd_level = detect_simd_level();
+}
+
+template <std::size_t NS, typename Block>
+void test_avx512_kernel(Block&& b) {
+    // The AVX-512 kernel moves the copies like the scalar one, also when NS
+    // leaves padding lanes in the last register
+    BlockMoveTable table(b);
+    std::array<unsigned, NS> rotations;
+    for (unsigned k = 0; k < NS; ++k) {
+        rotations[k] = (7 * k) % N_SYM;
+    }
+    SymMoveTable sym_table(table, rotations);
+
+    auto cc = CubieCube::random_state();
+    auto cube = make_sym_block_cube(b, cc, rotations);
+    auto scalar = cube;
+    Algorithm alg("F2 R' D L2 B U' R2 F' D2 L B' U2 R F D' L' B2 U");
+    for (Move move : alg.sequence) {
+#ifdef BLOCK_SOLVER_X86_SIMD
+        sym_table.apply_avx512(move, cube);
+#endif
+        sym_table.apply_scalar(move, scalar);
+        for (unsigned k = 0; k < NS; ++k) {
+            assert(cube[k] == scalar[k]);
+        }
+    }
+}
+
+int main() {
+    std::vector<SimdLevel> levels{SimdLevel::scalar};
+    if (detect_simd_level() >= SimdLevel::avx2) {
+        levels.push_back(SimdLevel::avx2);
+    }
+    if (detect_simd_level() >= SimdLevel::avx512) {
+        levels.push_back(SimdLevel::avx512);
+    }
+
+    for (auto level : levels) {
+        // 12 and 24 symmetries leave padding lanes, 48 fills AVX-512 registers
+        test_sym_apply<12>(Block<2, 3>("DB_123", {DLB, DRB}, {DB, RB, LB}),
+                           level);
+        test_sym_apply<24>(
+            Block<3, 3>("222_w_extra_corners", {DLF, DLB, DRB}, {DL, LB, DB}),
+            level);
+        test_sym_apply<48>(Block<1, 3>("DLB_222", {DLB}, {LB, DB, DL}), level);
+        test_sym_apply<48>(Block<8, 0>("Corners",
+                                       {ULF, URF, URB, ULB, DLF, DRF, DRB, DLB},
+                                       {}),
+                           level);
+    }
+
+    if (detect_simd_level() >= SimdLevel::avx512) {
+        test_avx512_kernel<12>(Block<2, 3>("DB_123", {DLB, DRB}, {DB, RB, LB}));
+        test_avx512_kernel<24>(Block<3, 3>(
+            "222_w_extra_corners", {DLF, DLB, DRB}, {DL, LB, DB}));
+    }
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include "two_gen.hpp"
 
+#include <algorithm>
+
 #include "search.hpp"
 
 void pairing_test() {
@@ -32,6 +34,23 @@ void corner_index_test() {
     assert(check_duplicates.size() == 120);
 }
 
+void two_gen_move_table_test() {
+    // The move tables agree with the moves of the cubies
+    auto& table = two_gen::m_table.get();
+    CubieCube cc;
+    auto cube = two_gen::cc_to_cube(cc, two_gen::rotations[0]);
+    Algorithm alg("R U2 R' U' R2 U R U' R' U2 R2 U R' U2 R U R2 U' R'");
+    for (Move move : alg.sequence) {
+        unsigned k = std::find(two_gen::moves.begin(), two_gen::moves.end(),
+                               move) -
+                     two_gen::moves.begin();
+        table.apply(k, cube);
+        cc.apply(move);
+        assert(cube.corners == two_gen::corner_index(cc));
+        assert(cube.edges == two_gen::edge_index(cc));
+    }
+}
+
 void two_gen_finish_test() {
     two_gen::load_tables();
     auto root = two_gen::initialize("B L B L B L B L B L B L B L B");
@@ -39,6 +58,11 @@ void two_gen_finish_test() {
     auto solutions = two_gen::solve(root, 20, 0);
     assert(solutions.size() == 2);
     assert(solutions[0]->depth == 15);
+
+    // Not two gen from any rotation: no solutions
+    auto other = CubieCube(Algorithm("R U F D L B"));
+    assert(!two_gen::two_gen_symmetry(other));
+    assert(two_gen::solve(make_root(other), 20, 0).empty());
 }
 
 void two_gen_reduction_index_test() {
@@ -46,24 +70,26 @@ void two_gen_reduction_index_test() {
     two_gen_reduction::load_tables();
     auto root = two_gen_reduction::cc_initialize(CubieCube());
     auto cube = root->state;
+    auto& apply = two_gen_reduction::apply.get();
+    auto& estimate = two_gen_reduction::estimate.get();
 
     assert(two_gen_reduction::is_solved(cube));
     for (auto move : {R, U, R3, U2, R}) {
-        two_gen_reduction::apply(move, cube);
+        apply(move, cube);
     }
     assert(two_gen_reduction::is_solved(cube));
-    assert(two_gen_reduction::estimate(cube) == 0);
+    assert(estimate(cube) == 0);
 
     for (auto move : {F, B3, R2, F3, B}) {
-        two_gen_reduction::apply(move, cube);
+        apply(move, cube);
     }
     assert(two_gen_reduction::is_solved(cube));
-    assert(two_gen_reduction::estimate(cube) == 0);
+    assert(estimate(cube) == 0);
 
-    two_gen_reduction::apply(F, cube);
-    assert(two_gen_reduction::max_estimate(cube[1]) == 1);
-    two_gen_reduction::apply(B, cube);
-    assert(two_gen_reduction::max_estimate(cube[1]) == 2);
+    apply(F, cube);
+    assert(estimate.max_estimate(cube[1]) == 1);
+    apply(B, cube);
+    assert(estimate.max_estimate(cube[1]) == 2);
 }
 
 void two_gen_reduction_solve_test() {
@@ -89,6 +115,7 @@ int main() {
     pairing_test();
     two_gen_index_test();
     corner_index_test();
+    two_gen_move_table_test();
     two_gen_finish_test();
     two_gen_reduction_index_test();
     two_gen_reduction_solve_test();